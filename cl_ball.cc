@@ -10,19 +10,26 @@ cl_ball::cl_ball(): cl_object(TYPE_BALL)
 }
 
 
+
+cl_ball::~cl_ball()
+{
+	delete explode;
+}
+
+
 //////////////////////////// OVERLOADED VIRTUALS /////////////////////////////
 
 void cl_ball::activate()
 {
 	setStage(STAGE_RUN);
-	x = player->ball_x;
-	y = player->ball_y;
+	x = game->player->ball_x;
+	y = game->player->ball_y;
 
-	if (player->superball)
+	if (game->player->superball)
 	{
 		// Means it'll kill 2 monsters before it goes back to normal
 		// which means it can kill 3 in total.
-		switch(level)
+		switch(game->level)
 		{
 		case 1:
 		case 2:
@@ -51,7 +58,7 @@ void cl_ball::activate()
 		speed = SLOW_SPEED;
 	}
 
-	switch(player->facing_dir)
+	switch(game->player->facing_dir)
 	{
 	case DIR_LEFT:
 		x_mult = -1;
@@ -73,7 +80,7 @@ void cl_ball::activate()
 		assert(0);
 	}
 
-	explode_time = level < 8 ? 200 - level * 20 : 40;
+	explode_time = game->level < 8 ? 200 - game->level * 20 : 40;
 }
 
 
@@ -85,9 +92,8 @@ void cl_ball::run()
 	int sy;
 	int ex;
 	int ey;
-	int x2;
-	int y2;
 	int add;
+	int dist;
 
 	++stage_cnt;
 
@@ -98,7 +104,7 @@ void cl_ball::run()
 		break;
 
 	case STAGE_EXPLODE:
-		if (stage_cnt == explode_time || player->superball)
+		if (stage_cnt == explode_time || game->player->superball)
 		{
 			explode_time = stage_cnt;
 			setStage(STAGE_MATERIALISE);
@@ -107,8 +113,8 @@ void cl_ball::run()
 		return;
 
 	case STAGE_MATERIALISE:
-		x = player->x;
-		y = player->y;
+		x = game->player->x;
+		y = game->player->y;
 		if (stage_cnt == explode_time - 35)
 			playFGSound(SND_BALL_RETURN);
 		else
@@ -132,30 +138,20 @@ void cl_ball::run()
 	   would almost always be positive and we wouldn't know whether to 
 	   reverse X or Y direction */
 	add = (ex > sx ? 1 : -1);
-	for(x2=sx;;x2 += add)
+	if ((dist = wallDistX(sx,sy,add,abs(ex - sx))) != -1)
 	{
-		if (outsideTunnel(x2,sy)) 
-		{
-			x_mult = -x_mult;
-			x += (x2 - sx);
-			playFGSound(SND_BALL_BOUNCE);
-			break;
-		}
-		if (x2 == ex) break;
+		x_mult = -x_mult;
+		x += dist * add;
+		playFGSound(SND_BALL_BOUNCE);
 	}
 
 	// Check vertical
 	add = (ey > sy ? 1 : -1);
-	for(y2=sy;;y2 += add)
+	if ((dist = wallDistY(sx,sy,add,abs(ey - sy))) != -1)
 	{
-		if (outsideTunnel(sx,y2)) 
-		{
-			y_mult = -y_mult;
-			y += (y2 - sy);
-			playFGSound(SND_BALL_BOUNCE);
-			break;
-		}
-		if (y2 == ey) break;
+		y_mult = -y_mult;
+		y += dist * add;
+		playFGSound(SND_BALL_BOUNCE);
 	}
 
 	x += speed * x_mult;
@@ -219,7 +215,7 @@ void cl_ball::draw()
 	case STAGE_RUN:
 		if (superball_cnt)
 		{
-			col = random() % NUM_FULL_COLOURS;
+			col = getRandom(RAND_GFX) % NUM_FULL_COLOURS;
 			drawOrFillCircle(col,0,diam,x,y,FILL);
 
 			// Draw rings. Just eye candy.
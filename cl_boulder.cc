@@ -2,8 +2,6 @@
 
 #define PUSH_SPEED 0.5
 
-static int cnum;
-
 
 /*** Constructor does nothing ***/
 cl_boulder::cl_boulder(): cl_rock(TYPE_BOULDER)
@@ -12,16 +10,17 @@ cl_boulder::cl_boulder(): cl_rock(TYPE_BOULDER)
 
 	for(i=0;i < NUM_SMALL_BOULDERS;++i)
 		small_boulder[i] = new cl_small_boulder(this);
+	fall_watch.watching = false;
 
-	// Find our position in list - this will never change during the
-	// life of the process.
-	list_pos = 0;
-	for(auto obj: objects)
-	{
-		if (!obj) break;
-		if (obj->type == TYPE_BOULDER) ++list_pos;
-	}
-	assert(list_pos < MAX_BOULDERS);
+	// Our position in the pool. Set by newGame() once the pool is made.
+	list_pos = -1;
+}
+
+
+
+cl_boulder::~cl_boulder()
+{
+	for(int i=0;i < NUM_SMALL_BOULDERS;++i) delete small_boulder[i];
 }
 
 
@@ -63,17 +62,19 @@ void cl_boulder::activate()
 	cant_push_cnt = 0;
 	cant_push_dir = DIR_STOP;
 	curr_tunnel = NULL;
-	break_height = level < 15 ? 400 - 20 * level : 100;
-	wobble_cnt = level < 10 ? 60 - 3 * level : 30;
+	break_height = game->level < 15 ? 400 - 20 * game->level : 100;
+	wobble_cnt = game->level < 10 ? 60 - 3 * game->level : 30;
 
 	// If we're the first boulder set the centre array num
-	if (!list_pos) cnum = random() % 2;
+	if (!list_pos) game->boulder_layout = getRandom(RAND_GAME) % 2;
 
 	/* Get our centre location and pick a random location near it.
 	   Since boulders are activated first we don't have to worry about
 	   ending up on top of a nugget. Nuggets have to avoid boulders. */
-	x = (double)centre[cnum][list_pos].x + (random() % SCR_Q1) - LEEWAY;
-	y = (double)centre[cnum][list_pos].y + (random() % SCR_Q1) - LEEWAY;
+	x = (double)centre[game->boulder_layout][list_pos].x + 
+	    (getRandom(RAND_GAME) % SCR_Q1) - LEEWAY;
+	y = (double)centre[game->boulder_layout][list_pos].y + 
+	    (getRandom(RAND_GAME) % SCR_Q1) - LEEWAY;
 
 	resetFallCheck();
 }
@@ -107,10 +108,19 @@ void cl_boulder::run()
 		else
 			cant_push_dir = DIR_STOP;
 
-		// Middle must be clear and either one side or the other 
-		// before we fall
-		if (!on_boulder && insideTunnel((int)x,fall_y))
+		/* Middle must be clear and either one side or the other 
+		   before we fall. The ground under us can only go when it's
+		   dug so rather than look every tick we get told. Only need
+		   to set the watch again if we've moved. */
+		if (!fall_watch.watching ||
+		    fall_watch.x1 != (int)x || fall_watch.y1 != fall_y)
+		{
+			watchDigArea(&fall_watch,(int)x,fall_y,(int)x,fall_y);
+		}
+		if (!on_boulder && fall_watch.dug)
 		{
+			// Set again when we land
+			unwatchDigArea(&fall_watch);
 			setStage(STAGE_WOBBLE);
 			playFGSound(SND_BOULDER_WOBBLE);
 		}
@@ -176,10 +186,11 @@ void cl_boulder::run()
 
 	case STAGE_BEING_EATEN:
 		// Slowly get smaller
-		if (stage_cnt == eating_time) setStage(STAGE_INACTIVE);
+		if (stage_cnt == game->eating_time) setStage(STAGE_INACTIVE);
 		else
 		{
-			xsize = ysize = (double)(eating_time - stage_cnt) / eating_time;
+			xsize = ysize = (double)(game->eating_time - stage_cnt) /
+			                game->eating_time;
 			runSmallBoulders();
 		}
 		break;
@@ -203,7 +214,7 @@ void cl_boulder::setCurrTunnel()
 	double best_dist = FAR_FAR_AWAY;
 	double dist;
 
-	for(auto tun: tunnels)
+	for(auto tun: game->tunnels)
 	{
 		/* Can be in a number of tunnels at once. Find one we closest
 		   to the centre line of. This isn't a perfect solution as we
@@ -264,6 +275,7 @@ double cl_boulder::push(en_dir push_dir)
 /*** Called by grubble ***/
 void cl_boulder::setBeingEaten()
 {
+	unwatchDigArea(&fall_watch);
 	setStage(STAGE_BEING_EATEN);
 	activateSmallBoulders();
 }
@@ -331,8 +343,8 @@ void cl_boulder::draw()
 	case STAGE_WOBBLE:
 		x2 = x;
 		y2 = y;
-		x += (random() % 10) - 5;
-		y += (random() % 10) - 5;
+		x += (getRandom(RAND_GFX) % 10) - 5;
+		y += (getRandom(RAND_GFX) % 10) - 5;
 		cl_rock::draw();
 		x = x2;
 		y = y2;
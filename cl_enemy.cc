@@ -8,6 +8,13 @@ cl_enemy::cl_enemy(en_type t): cl_object(t)
 
 
 
+cl_enemy::~cl_enemy()
+{
+	delete explode;
+}
+
+
+
 
 /*** (Re)start ***/
 void cl_enemy::activate()
@@ -24,7 +31,7 @@ void cl_enemy::activate()
 	hit_player = false;
 
 	// Set start tunnel
-	curr_tunnel = *(tunnels.begin());
+	curr_tunnel = *(game->tunnels.begin());
 }
 
 
@@ -56,7 +63,7 @@ void cl_enemy::attractRun()
 /*** Called by spooky and grubble ***/
 void cl_enemy::stageMaterialise()
 {
-	if ((y += materialise_y_add) >= START_Y)
+	if ((y += game->materialise_y_add) >= START_Y)
 	{
 		y = START_Y;
 		setStage(STAGE_RUN);
@@ -128,8 +135,8 @@ void cl_enemy::pickPlayerDirTunnel()
 	double yd;
 	bool vert;
 
-	xd = player->x - x;
-	yd = player->y - y;
+	xd = game->player->x - x;
+	yd = game->player->y - y;
 	vert = (fabs(yd) > fabs(xd));
 
 	for(it=curr_tunnel->links.begin();it != curr_tunnel->links.end();++it)
@@ -183,7 +190,7 @@ void cl_enemy::pickRandomTunnel()
 	// Find a new tunnel but not back the way we've come
 	do
 	{
-		next_tunnel = curr_tunnel->links[random() % cnt];
+		next_tunnel = curr_tunnel->links[getRandom(RAND_GAME) % cnt];
 	} while(next_tunnel == prev_tunnel);
 }
 
@@ -256,19 +263,15 @@ en_dir cl_enemy::dirToTunnel(cl_tunnel *from, cl_tunnel *to)
 
 
 
-/*** This is called by cl_tunnel when a tunnel is being deleted because its 
-     on the route of a previous tunnel ***/
-void cl_enemy::updateTunnelPtrs(cl_tunnel *oldtun, cl_tunnel *newtun)
+/*** Called at the start of run(). If the tunnel we're in or heading for 
+     has been merged into another since we last ran then reset next_tunnel
+     as it may no longer be appropriate. Our handles already point at the
+     new tunnel, this just saves following the merge every time. ***/
+void cl_enemy::checkTunnelMerge()
 {
-	if (prev_tunnel == oldtun) prev_tunnel = newtun;
-
-	// Reset next_tunnel to null because it may no longer be appropriate
-	if (curr_tunnel == oldtun)
-	{
-		curr_tunnel = newtun;
-		next_tunnel = NULL;
-	}
-	if (next_tunnel == oldtun) next_tunnel = NULL;
+	if (curr_tunnel.merged() || next_tunnel.merged()) next_tunnel = NULL;
+	prev_tunnel.follow();
+	curr_tunnel.follow();
 }
 
 
@@ -279,7 +282,7 @@ void cl_enemy::updateTunnelPtrs(cl_tunnel *oldtun, cl_tunnel *newtun)
      Spooky and Grubble ***/
 void cl_enemy::hitPlayerMove()
 {
-	double dist = distToObject(player);
+	double dist = distToObject(game->player);
 
 	// If we're getting further away - eg if we're moving perpendicular 
 	// to player and just brushed him - then stop
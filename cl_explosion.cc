@@ -54,6 +54,16 @@ cl_explosion::cl_explosion(cl_object *own)
 
 
 
+cl_explosion::~cl_explosion()
+{
+	delete[] x;
+	delete[] y;
+	delete[] x_add;
+	delete[] y_add;
+}
+
+
+
 
 /*** Set up all the important stuff ***/
 void cl_explosion::activate()
@@ -114,8 +124,8 @@ void cl_explosion::activate()
 		case TYPE_WURMAL:
 		case TYPE_SPIKY:
 			// Random explosion
-			x_add[i] = SIN(ang) * (random() % 20) + 1;
-			y_add[i] = COS(ang) * (random() % 20) + 1;
+			x_add[i] = SIN(ang) * (getRandom(RAND_GFX) % 20) + 1;
+			y_add[i] = COS(ang) * (getRandom(RAND_GFX) % 20) + 1;
 			break;
 
 		default:
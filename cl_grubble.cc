@@ -107,8 +107,8 @@ void cl_grubble::activate()
 	eye_col = COL_WHITE;
 	pup_col = COL_BLUE;
 
-	start_speed = speed = (level < 20 ? 2.2 + 0.2 * level : 6.2);
-	max_depth = level < 4 ? 3 + level : 7;
+	start_speed = speed = (game->level < 20 ? 2.2 + 0.2 * game->level : 6.2);
+	max_depth = game->level < 4 ? 3 + game->level : 7;
 
 	playFGSound(SND_ENEMY_MATERIALISE);
 }
@@ -122,6 +122,7 @@ void cl_grubble::attractActivate()
 	cl_enemy::attractActivate();
 
 	y = 260;
+	bodynum = 0;
 	body_col = COL_PURPLE;
 	teeth_col = COL_YELLOW;
 	eye_col = COL_WHITE;
@@ -135,6 +136,7 @@ void cl_grubble::attractActivate()
 /*** Terrorise the place ***/
 void cl_grubble::run()
 {
+	checkTunnelMerge();
 	++stage_cnt;
 	prev_x = x;
 	prev_y = y;
@@ -187,7 +189,7 @@ void cl_grubble::stageRun()
 	double dist;
 
 	// If frozen , do nothing
-	if (player->freeze_timer) return;
+	if (game->player->freeze_timer) return;
 
 	// Shouldn't happen but occasionally does
 	if (outsideTunnel((int)x,(int)y))
@@ -208,7 +210,7 @@ void cl_grubble::stageRun()
 	}
 
 	// Speed up if turbo speed is on
-	if (player->turbo_enemy_timer)
+	if (game->player->turbo_enemy_timer)
 	{
 		if (speed == start_speed) speed = speed * 2;
 	}
@@ -225,7 +227,7 @@ void cl_grubble::stageRun()
 			move();
 			dist_to_food = dist;
 		}
-		if (stage_cnt < eating_time) return;
+		if (stage_cnt < game->eating_time) return;
 
 		eating = false;
 		dist_to_food = FAR_FAR_AWAY;
@@ -252,7 +254,6 @@ void cl_grubble::stageRun()
 			// Check return code just in case its suddenly moved 
 			// without us noticing
 			if (findShortestPath(
-				0,
 				max_depth,
 				curr_tunnel,
 				dinner->curr_tunnel,next_tunnel) == -1)
@@ -264,21 +265,18 @@ void cl_grubble::stageRun()
 		}
 	}
 	// If player is invisible just move randomly
-	else if (player->invisible_timer)
+	else if (game->player->invisible_timer)
 	{
 		pickRandomTunnel();
 		setDirection();
 	}
 	// If we're in the same tunnel as player head for him
-	else if (curr_tunnel == player->curr_tunnel) 
-		setDirectionToObject(player);
+	else if (curr_tunnel == game->player->curr_tunnel) 
+		setDirectionToObject(game->player);
 	// Look for some dinner else find player
 	else if (!findDinner()) 
 	{
-		if (findShortestPath(
-			0,
-			max_depth,
-			curr_tunnel,player->curr_tunnel,next_tunnel) == -1)
+		if (findPathToPlayer(max_depth,curr_tunnel,next_tunnel) == -1)
 		{
 			pickRandomTunnel();
 		}
@@ -331,13 +329,13 @@ void cl_grubble::move()
 /*** Find a boulder sitting in a tunnel we can munch on ***/
 bool cl_grubble::findDinner()
 {
-	for(auto obj: objects)
+	cl_object *obj;
+
+	for(obj=game->active_list[TYPE_BOULDER].head;obj;obj=obj->list_next)
 	{
-		if (obj->type == TYPE_BOULDER && 
-		    obj->stage == STAGE_RUN &&
+		if (obj->stage == STAGE_RUN &&
 		    obj->curr_tunnel &&
 		    findShortestPath(
-			0,
 			5,
 			curr_tunnel,obj->curr_tunnel,next_tunnel) != -1)
 		{
@@ -404,7 +402,7 @@ void cl_grubble::haveCollided(cl_object *obj, double dist)
 		break;
 
 	case TYPE_PLAYER:
-		if (!player->freeze_timer)
+		if (!game->player->freeze_timer)
 		{
 			hit_player = true;
 			body_col = COL_RED;
@@ -428,12 +426,12 @@ void cl_grubble::draw()
 	{
 	case STAGE_MATERIALISE:
 		// Just flash
-		if ((game_stage_cnt % 4) < 2) return;
+		if ((game->game_stage_cnt % 4) < 2) return;
 		break;
 
 	case STAGE_RUN:
-		if (!(game_stage_cnt % 10)) bodynum = !bodynum;
-		bcol = player->freeze_timer ? COL_MEDIUM_BLUE : body_col;
+		if (!(game->game_stage_cnt % 10)) bodynum = !bodynum;
+		bcol = game->player->freeze_timer ? COL_MEDIUM_BLUE : body_col;
 		break;
 
 	case STAGE_FALL:
@@ -9,11 +9,11 @@ void cl_molehill::reset()
 	int x2;
 	int width;
 
-	width  = 50 + random() % 100;
+	width  = 50 + getRandom(RAND_GFX) % 100;
 
 	do
 	{
-		x1 = random() % (SCR_SIZE - width);
+		x1 = getRandom(RAND_GFX) % (SCR_SIZE - width);
 		x2 = x1 + width;
 	} while(!((x1 <= START_X1 && x2 <= START_X1) || 
 	          (x1 >= START_X2 && x2 >= START_X2)));
@@ -22,7 +22,7 @@ void cl_molehill::reset()
 	vertex[0].y = PLAY_AREA_TOP;
 
 	vertex[1].x = (x1 + x2) / 2;
-	vertex[1].y = PLAY_AREA_TOP - (5 + random() % 15);
+	vertex[1].y = PLAY_AREA_TOP - (5 + getRandom(RAND_GFX) % 15);
 
 	vertex[2].x = x2;
 	vertex[2].y = PLAY_AREA_TOP;
@@ -34,5 +34,5 @@ void cl_molehill::reset()
 void cl_molehill::draw()
 {
 	memcpy(tmp_points,vertex,sizeof(XPoint) * 3);
-	drawOrFillPolygon(ground_colour,0,tmp_points,3,FILL);
+	drawOrFillPolygon(game->ground_colour,0,tmp_points,3,FILL);
 }
@@ -19,57 +19,57 @@ void cl_nugget::activate()
 	xmod = SCR_SIZE - diam;
 	ymod = PLAY_AREA_HEIGHT - diam;
 
-	start_col = col = COL_YELLOW + (random() % 5) - 2;
+	start_col = col = COL_YELLOW + (getRandom(RAND_GFX) % 5) - 2;
 
-	if (invisible_powerup_cnt)
+	if (game->invisible_powerup_cnt)
 	{
 		nugtype = INVISIBILITY;
-		--invisible_powerup_cnt;
+		--game->invisible_powerup_cnt;
 	}
-	else if (superball_powerup_cnt)
+	else if (game->superball_powerup_cnt)
 	{
 		nugtype = SUPERBALL;
-		--superball_powerup_cnt;
+		--game->superball_powerup_cnt;
 	}
-	else if (freeze_powerup_cnt)
+	else if (game->freeze_powerup_cnt)
 	{
 		nugtype = FREEZE;
-		--freeze_powerup_cnt;
+		--game->freeze_powerup_cnt;
 		col = COL_BLUE;
 	}
-	else if (bonus_nugget_cnt)
+	else if (game->bonus_nugget_cnt)
 	{
 		// Not actually a powerup, just a nugget that gives a bonus
 		// score, but simpler to use powerup enum
 		nugtype = BONUS;
-		--bonus_nugget_cnt;
+		--game->bonus_nugget_cnt;
 		setBonusTime();
 	}
-	else if (turbo_enemy_powerup_cnt)
+	else if (game->turbo_enemy_powerup_cnt)
 	{
 		// Powerup for the spooky and grubble who move around much 
 		// faster.
 		nugtype = TURBO_ENEMY;
-		--turbo_enemy_powerup_cnt;
+		--game->turbo_enemy_powerup_cnt;
 		col = COL_RED2;
 	}
 	else nugtype = NORMAL;
 
 	give_bonus = false;
-	++nugget_cnt;
+	++game->nugget_cnt;
 
 	// Pick random spot thats not within a certain distance of player and
 	// start location and not in a start tunnel. 
 	LOOP:
 	do
 	{
-		x = (random() % xmod) + radius;
-		y = PLAY_AREA_TOP + (random() % ymod) + radius;
+		x = (getRandom(RAND_GAME) % xmod) + radius;
+		y = PLAY_AREA_TOP + (getRandom(RAND_GAME) % ymod) + radius;
 	} while(insideTunnel((int)x,(int)y) ||
 	        hypot(x - START_X,y - START_Y) < TUNNEL_WIDTH * 2);
 
 	// Check against other objects
-	for(auto obj: objects)
+	for(auto obj: game->objects)
 		if (obj != this && overlapDist(obj)) goto LOOP;
 }
 
@@ -79,7 +79,7 @@ void cl_nugget::activate()
 /*** Set up the countdown for the nugget to give special bonus ***/
 void cl_nugget::setBonusTime()
 {
-	bonus_time = stage_cnt + 100 + random() % 200;
+	bonus_time = stage_cnt + 100 + getRandom(RAND_GAME) % 200;
 }
 
 
@@ -98,7 +98,7 @@ void cl_nugget::run()
 		if (xsize < 0.2)
 		{
 			setStage(STAGE_INACTIVE);
-			--nugget_cnt;
+			--game->nugget_cnt;
 		}
 		return;
 	}
@@ -178,11 +178,11 @@ void cl_nugget::draw()
 		break;
 
 	case INVISIBILITY:
-		fill = (game_stage_cnt % 20 < 10) ? DRAW : FILL;
+		fill = (game->game_stage_cnt % 20 < 10) ? DRAW : FILL;
 		break;
 
 	case SUPERBALL:
-		col = random() % NUM_FULL_COLOURS;
+		col = getRandom(RAND_GFX) % NUM_FULL_COLOURS;
 		break;
 
 	case FREEZE:
@@ -192,11 +192,11 @@ void cl_nugget::draw()
 	case BONUS:
 		// game_stage_cnt not incremented during a pause so sizes
 		// could keep on getting bigger or smaller if game paused
-		if (give_bonus && !paused)
+		if (give_bonus && !game->paused)
 		{
-			if (!game_stage_cnt) resetBonusColSize();
+			if (!game->game_stage_cnt) resetBonusColSize();
 
-			if (game_stage_cnt % 10 < 5)
+			if (game->game_stage_cnt % 10 < 5)
 			{
 				xsize += 0.1;
 				ysize += 0.1;
@@ -215,7 +215,7 @@ void cl_nugget::draw()
 		break;
 
 	case TURBO_ENEMY:
-		col = (game_stage_cnt % 10 < 5 ? COL_RED : COL_BLACK);
+		col = (game->game_stage_cnt % 10 < 5 ? COL_RED : COL_BLACK);
 		break;
 
 	default:
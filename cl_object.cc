@@ -1,7 +1,16 @@
 #include "globals.h"
 
+static void listRemove(st_obj_list *list, cl_object *obj);
+static void listInsert(st_obj_list *list, cl_object *obj);
+
+
 cl_object::cl_object(en_type t)
 {
+	listed = false;
+	list_prev = NULL;
+	list_next = NULL;
+	slot = -1;
+
 	setStage(STAGE_INACTIVE);
 	type = t;
 	x = 0;
@@ -102,6 +111,20 @@ void cl_object::incAngle(double inc)
 /*** Set the objects stage and play appropriate sound if required ***/
 void cl_object::setStage(en_object_stage stg)
 {
+	// Move between the free and active lists if need be
+	if (listed && (stage == STAGE_INACTIVE) != (stg == STAGE_INACTIVE))
+	{
+		if (stg == STAGE_INACTIVE)
+		{
+			listRemove(&game->active_list[type],this);
+			listInsert(&game->free_list[type],this);
+		}
+		else
+		{
+			listRemove(&game->free_list[type],this);
+			listInsert(&game->active_list[type],this);
+		}
+	}
 	stage = stg;
 	stage_cnt = 0;
 }
@@ -124,3 +147,221 @@ double cl_object::overlapDist(cl_object *obj)
 	double dist = radius + obj->radius - distToObject(obj);
 	return (dist <= 0 ? 0 : dist);
 }
+
+
+
+
+/*** Radius of a circle round the centre that the whole object is inside.
+     Used by the collision grid. ***/
+double cl_object::boundRadius()
+{
+	return radius;
+}
+
+
+//////////////////////////////// OBJECT LISTS /////////////////////////////////
+
+/*** Put everything in objects[] into the list for its type. Called once
+     objects[] has been filled in. ***/
+void initObjectLists()
+{
+	cl_object *obj;
+
+	bzero(game->active_list,sizeof(game->active_list));
+	bzero(game->free_list,sizeof(game->free_list));
+
+	for(int i=0;i < MAX_OBJECTS;++i)
+	{
+		obj = game->objects[i];
+		obj->slot = i;
+		obj->listed = true;
+		if (obj->stage == STAGE_INACTIVE)
+			listInsert(&game->free_list[obj->type],obj);
+		else
+			listInsert(&game->active_list[obj->type],obj);
+	}
+}
+
+
+
+
+/*** objects[] is created in en_type order so going through the types in 
+     order gives the active objects in objects[] order ***/
+cl_object *firstActiveObject()
+{
+	for(int t=0;t < NUM_TYPES;++t)
+		if (game->active_list[t].head) return game->active_list[t].head;
+	return NULL;
+}
+
+
+
+
+/*** Returns the active object that comes after the given one in objects[].
+     The given object may have just been deactivated, eg by its own run(), 
+     so it can't always just follow the link. ***/
+cl_object *nextActiveObject(cl_object *obj)
+{
+	cl_object *next;
+	int t;
+
+	if (obj->stage != STAGE_INACTIVE)
+		next = obj->list_next;
+	else
+	{
+		for(next=game->active_list[obj->type].head;
+		    next && next->slot < obj->slot;next=next->list_next);
+	}
+	if (next) return next;
+
+	for(t=obj->type+1;t < NUM_TYPES;++t)
+		if (game->active_list[t].head) return game->active_list[t].head;
+	return NULL;
+}
+
+
+
+
+void listRemove(st_obj_list *list, cl_object *obj)
+{
+	if (obj->list_prev)
+		obj->list_prev->list_next = obj->list_next;
+	else
+		list->head = obj->list_next;
+
+	if (obj->list_next)
+		obj->list_next->list_prev = obj->list_prev;
+	else
+		list->tail = obj->list_prev;
+
+	obj->list_prev = NULL;
+	obj->list_next = NULL;
+	--list->cnt;
+}
+
+
+
+
+/*** Insert keeping the list in slot order ***/
+void listInsert(st_obj_list *list, cl_object *obj)
+{
+	cl_object *prev;
+
+	for(prev=list->tail;prev && prev->slot > obj->slot;prev=prev->list_prev);
+
+	obj->list_prev = prev;
+	if (prev)
+	{
+		obj->list_next = prev->list_next;
+		prev->list_next = obj;
+	}
+	else
+	{
+		obj->list_next = list->head;
+		list->head = obj;
+	}
+
+	if (obj->list_next)
+		obj->list_next->list_prev = obj;
+	else
+		list->tail = obj;
+
+	++list->cnt;
+}
+
+
+//////////////////////////////// OBJECT POOLS /////////////////////////////////
+
+/*** Run every active object in a pool. Calling T's own run() rather than
+     going through the vtable lets the compiler call it directly and inline
+     it. The stage is checked as each one is reached because an earlier
+     object can deactivate a later one. ***/
+template <class T>
+static int runPool(T *pool, int cnt)
+{
+	int num = 0;
+
+	for(T *obj=pool,*end=pool+cnt;obj < end;++obj)
+	{
+		if (obj->stage != STAGE_INACTIVE)
+		{
+			obj->T::run();
+			++num;
+		}
+	}
+	return num;
+}
+
+
+
+
+template <class T>
+static void drawPool(T *pool, int cnt)
+{
+	for(T *obj=pool,*end=pool+cnt;obj < end;++obj)
+		if (obj->stage != STAGE_INACTIVE) obj->T::draw();
+}
+
+
+
+
+/*** Run all the objects in objects[] order. Returns how many were run. 
+     -virtual does it the old way through the vtable for comparison. ***/
+int runObjects()
+{
+	cl_object *obj;
+	int num = 0;
+
+	if (virtual_dispatch)
+	{
+		for(obj=firstActiveObject();obj;obj=nextActiveObject(obj))
+		{
+			obj->run();
+			++num;
+		}
+		return num;
+	}
+
+	if (game->player->stage != STAGE_INACTIVE)
+	{
+		game->player->cl_player::run();
+		++num;
+	}
+	if (game->ball->stage != STAGE_INACTIVE)
+	{
+		game->ball->cl_ball::run();
+		++num;
+	}
+	num += runPool(game->nugget_pool,MAX_NUGGETS);
+	num += runPool(game->boulder_pool,MAX_BOULDERS);
+	num += runPool(game->spooky_pool,MAX_SPOOKYS);
+	num += runPool(game->spiky_pool,MAX_SPIKYS);
+	num += runPool(game->grubble_pool,MAX_GRUBBLES);
+	num += runPool(game->wurmal_pool,MAX_WURMALS);
+	return num;
+}
+
+
+
+
+/*** As above for drawing ***/
+void drawObjects()
+{
+	cl_object *obj;
+
+	if (virtual_dispatch)
+	{
+		for(obj=firstActiveObject();obj;obj=nextActiveObject(obj))
+			obj->draw();
+		return;
+	}
+
+	if (game->player->stage != STAGE_INACTIVE) game->player->cl_player::draw();
+	if (game->ball->stage != STAGE_INACTIVE) game->ball->cl_ball::draw();
+	drawPool(game->nugget_pool,MAX_NUGGETS);
+	drawPool(game->boulder_pool,MAX_BOULDERS);
+	drawPool(game->spooky_pool,MAX_SPOOKYS);
+	drawPool(game->spiky_pool,MAX_SPIKYS);
+	drawPool(game->grubble_pool,MAX_GRUBBLES);
+	drawPool(game->wurmal_pool,MAX_WURMALS);
+}
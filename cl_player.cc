@@ -25,15 +25,31 @@ XPoint cl_player::square2[NUM_POINTS] =
 ////////////////////////////////// START /////////////////////////////////////
 
 
+/*** The second square is the first turned by 45 degrees. Called once from
+     init() as the shapes are shared by every game. ***/
+void cl_player::initShapes()
+{
+	for(int i=0;i < NUM_POINTS;++i) rotate(square2[i].x,square2[i].y,45);
+}
+
+
+
+
 /*** Constructor ***/
 cl_player::cl_player(): cl_object(TYPE_PLAYER)
 {
-	for(int i=0;i < NUM_POINTS;++i) rotate(square2[i].x,square2[i].y,45);
 	explode = new cl_explosion(this);
 }
 
 
 
+cl_player::~cl_player()
+{
+	delete explode;
+}
+
+
+
 
 /*** Does a (re)set at the start of the level ***/
 void cl_player::activate()
@@ -62,16 +78,16 @@ void cl_player::activate()
 
 	// If theres a pre-existing start tunnel then link to it so enemies
 	// can follow us along it
-	if (tunnels.size() > 1)
+	if (game->tunnels.size() > 1)
 	{
-		prev_tunnel = tunnels[0];
+		prev_tunnel = game->tunnels[0];
 		curr_tunnel->linkTunnel(prev_tunnel);
 	}
 	else prev_tunnel = NULL;
 
-	speed = level < 20 ? 1.3 + 0.15 * level : 4.3;
+	speed = game->level < 20 ? 1.3 + 0.15 * game->level : 4.3;
 
-	switch(level)
+	switch(game->level)
 	{
 	case 1:
 		ball_ang_inc = 5;
@@ -125,7 +141,7 @@ void cl_player::run()
 	switch(stage)
 	{
 	case STAGE_RUN:
-		if (game_stage == GAME_STAGE_ATTRACT_PLAY)
+		if (game->game_stage == GAME_STAGE_ATTRACT_PLAY)
 			autoplay();
 		else
 			stageRun();
@@ -164,10 +180,11 @@ void cl_player::run()
 /*** During games attract mode ***/
 void cl_player::autoplay()
 {
+	cl_object *obj;
 	double xd;
 	double yd;
 
-	switch(game_stage_cnt)
+	switch(game->game_stage_cnt)
 	{
 	case 1:
 		move(XK_Down);
@@ -186,11 +203,11 @@ void cl_player::autoplay()
 		break;
 
 	case 160:
-		move(random() % 2 ? XK_Left : XK_Right);
+		move(getRandom(RAND_AUTOPLAY) % 2 ? XK_Left : XK_Right);
 		break;
 
 	case 250:
-		move(random() % 2 ? XK_Up : XK_Down);
+		move(getRandom(RAND_AUTOPLAY) % 2 ? XK_Up : XK_Down);
 		break;
 
 	default:
@@ -209,17 +226,13 @@ void cl_player::autoplay()
 		}
 
 		// See if an enemy is near and if so move away
-		for(auto obj: objects)
+		for(auto t: { TYPE_SPOOKY, TYPE_SPIKY, TYPE_GRUBBLE, TYPE_WURMAL })
 		{
-			if (obj->stage != STAGE_RUN && 
-			    obj->stage != STAGE_MATERIALISE) continue;
-
-			switch(obj->type)
+			for(obj=game->active_list[t].head;obj;obj=obj->list_next)
 			{
-			case TYPE_SPOOKY:
-			case TYPE_GRUBBLE:
-			case TYPE_WURMAL:
-			case TYPE_SPIKY:
+				if (obj->stage != STAGE_RUN && 
+				    obj->stage != STAGE_MATERIALISE) continue;
+
 				if (distToObject(obj) < 100)
 				{
 					throwBall();
@@ -232,13 +245,11 @@ void cl_player::autoplay()
 					stageRun();
 					return;
 				}
-
-			default:
-				break;
 			}
 		}
 
-		if (game_stage_cnt > 300 && !(random() % 100))
+		if (game->game_stage_cnt > 300 &&
+		    !(getRandom(RAND_AUTOPLAY) % 100))
 			autoplayRandomMove();
 	}
 		
@@ -254,7 +265,7 @@ void cl_player::autoplayRandomMove()
 	switch(prev_dir)
 	{
 	case DIR_STOP:
-		switch(random() % 4)
+		switch(getRandom(RAND_AUTOPLAY) % 4)
 		{
 		case 0:
 			move(XK_Up);
@@ -275,31 +286,31 @@ void cl_player::autoplayRandomMove()
 
 	case DIR_UP:
 		// Theres a 1 in 5 chance of reversing direction
-		if (!(random() % AUTOPLAY_REV_MOD))
+		if (!(getRandom(RAND_AUTOPLAY) % AUTOPLAY_REV_MOD))
 			move(XK_Down);
 		else
-			move(random() % 2 ? XK_Left : XK_Right);
+			move(getRandom(RAND_AUTOPLAY) % 2 ? XK_Left : XK_Right);
 		break;
 
 	case DIR_DOWN:
-		if (!(random() % AUTOPLAY_REV_MOD))
+		if (!(getRandom(RAND_AUTOPLAY) % AUTOPLAY_REV_MOD))
 			move(XK_Up);
 		else
-			move(random() % 2 ? XK_Left : XK_Right);
+			move(getRandom(RAND_AUTOPLAY) % 2 ? XK_Left : XK_Right);
 		break;
 
 	case DIR_LEFT:
-		if (!(random() % AUTOPLAY_REV_MOD))
+		if (!(getRandom(RAND_AUTOPLAY) % AUTOPLAY_REV_MOD))
 			move(XK_Right);
 		else
-			move(random() % 2 ? XK_Up : XK_Down);
+			move(getRandom(RAND_AUTOPLAY) % 2 ? XK_Up : XK_Down);
 		break;
 
 	case DIR_RIGHT:
-		if (!(random() % AUTOPLAY_REV_MOD))
+		if (!(getRandom(RAND_AUTOPLAY) % AUTOPLAY_REV_MOD))
 			move(XK_Left);
 		else
-			move(random() % 2 ? XK_Up : XK_Down);
+			move(getRandom(RAND_AUTOPLAY) % 2 ? XK_Up : XK_Down);
 		break;
 	}
 }
@@ -329,7 +340,8 @@ void cl_player::stageRun()
 			setGroundColour();
 			playBGSound(SND_SILENCE);
 		}
-		else ground_colour = COL_BLACK2 + (turbo_enemy_timer * 2 % 15);
+		else game->ground_colour =
+			COL_BLACK2 + (turbo_enemy_timer * 2 % 15);
 	}
 	if (freeze_timer)
 	{
@@ -338,7 +350,7 @@ void cl_player::stageRun()
 			setGroundColour();
 			echoOff();
 		}
-		else ground_colour = COL_MEDIUM_BLUE;
+		else game->ground_colour = COL_MEDIUM_BLUE;
 	}
 
 	if (ball_ang != req_ball_ang)
@@ -472,7 +484,7 @@ void cl_player::tunnelComplete()
 	// Returns pointer to pre-existing tunnel if we don't need current one
 	if ((tun = curr_tunnel->complete()))
 	{
-		delete curr_tunnel;
+		mergeTunnel(curr_tunnel,tun);
 		prev_tunnel = tun;
 	}
 	else prev_tunnel = curr_tunnel;
@@ -567,10 +579,10 @@ void cl_player::stop(KeySym key)
 /*** Throw the ball if its not already in play ***/
 void cl_player::throwBall()
 {
-	if (stage == STAGE_RUN && ball->stage == STAGE_INACTIVE)
+	if (stage == STAGE_RUN && game->ball->stage == STAGE_INACTIVE)
 	{
 		playFGSound(SND_BALL_THROW);
-		ball->activate();
+		game->ball->activate();
 		superball = false;
 		playBGSound(SND_SILENCE);
 	}
@@ -599,23 +611,25 @@ void cl_player::haveCollided(cl_object *obj, double dist)
 			break;
 
 		case cl_nugget::INVISIBILITY:
-			invisible_timer = level < 10 ? 350 - level * 10 : 250;
+			invisible_timer =
+				game->level < 10 ? 350 - game->level * 10 : 250;
 			fill = DRAW;
 			playBGSound(SND_INVISIBILITY_POWERUP);
-			text_invisibility_powerup->reset(this,0);
+			game->text_invisibility_powerup->reset(this,0);
 			break;
 
 		case cl_nugget::SUPERBALL:
 			superball = true;
 			playBGSound(SND_SUPERBALL_POWERUP);
-			text_superball_powerup->reset(this,0);
+			game->text_superball_powerup->reset(this,0);
 			break;
 
 		case cl_nugget::FREEZE:
-			freeze_timer = level < 10 ? 250 - level * 10 : 150;
+			freeze_timer =
+				game->level < 10 ? 250 - game->level * 10 : 150;
 			echoOn();
 			playFGSound(SND_FREEZE_POWERUP);
-			text_freeze_powerup->reset(this,0);
+			game->text_freeze_powerup->reset(this,0);
 			break;
 
 		case cl_nugget::BONUS:
@@ -623,7 +637,7 @@ void cl_player::haveCollided(cl_object *obj, double dist)
 			break;
 
 		case cl_nugget::TURBO_ENEMY:
-			turbo_enemy_timer = 100 + 10 * level;
+			turbo_enemy_timer = 100 + 10 * game->level;
 			playBGSound(SND_TURBO_ENEMY);
 			break;
 
@@ -718,21 +732,25 @@ void cl_player::draw()
 	drawLine(COL_YELLOW,5*xsize,x,y,ball_x,ball_y);
 
 	// Draw ball or its little holding cup if its not there
-	if (ball->stage == STAGE_INACTIVE)
+	if (game->ball->stage == STAGE_INACTIVE)
 	{
 		if (superball)
 		{
-			ball_diam = 10 + (game_stage_cnt % 20);
-			ball_col = random() % NUM_FULL_COLOURS;
+			ball_diam = 10 + (game->game_stage_cnt % 20);
+			ball_col = getRandom(RAND_GFX) % NUM_FULL_COLOURS;
 		}
 		else
 		{
-			ball_diam = ball->diam;
+			ball_diam = game->ball->diam;
 			ball_col = COL_RED;
 		}
 		ball_diam *= xsize;
 
 		drawOrFillCircle(ball_col,0,ball_diam,ball_x,ball_y,fill);
 	}
-	else drawOrFillCircle(COL_YELLOW,0,ball->diam / 2 * xsize,ball_x,ball_y,fill);
+	else
+	{
+		drawOrFillCircle(
+			COL_YELLOW,0,game->ball->diam / 2 * xsize,ball_x,ball_y,fill);
+	}
 }
@@ -9,6 +9,13 @@ cl_rock::cl_rock(en_type t): cl_object(t)
 
 
 
+cl_rock::~cl_rock()
+{
+	delete[] points;
+}
+
+
+
 
 /*** Create the rock shape ***/
 void cl_rock::activate()
@@ -28,22 +35,22 @@ void cl_rock::activate()
 	{
 	case TYPE_STONE:
 		diam = 8;
-		num_points = 5 + random() % 5;
+		num_points = 5 + getRandom(RAND_GFX) % 5;
 		break;
 
 	case TYPE_NUGGET:
 		diam = 30;
-		num_points = 5 + random() % 5;
+		num_points = 5 + getRandom(RAND_GFX) % 5;
 		break;
 
 	case TYPE_BOULDER:
 		diam = 60;
-		num_points = 10 + random() % 10;
+		num_points = 10 + getRandom(RAND_GFX) % 10;
 		break;
 
 	case TYPE_SMALL_BOULDER:
-		diam = 20 + random() % 10;
-		num_points = 5 + random() % 5;
+		diam = 20 + getRandom(RAND_GFX) % 10;
+		num_points = 5 + getRandom(RAND_GFX) % 5;
 		break;
 
 	default:
@@ -54,13 +61,14 @@ void cl_rock::activate()
 	ang_inc = (double)360 / num_points;
 
 	// Create the shape
-	if (points) delete points;
+	delete[] points;
 
 	points = new XPoint[num_points];
 	for(i=0,angle=0;i < num_points;++i,angle+=ang_inc)
 	{
 		len = (double)radius - 
-		      ((double)(random() % radius) - (double)(radius / 2)) / 4;
+		      ((double)(getRandom(RAND_GFX) % radius) - 
+		       (double)(radius / 2)) / 4;
 		points[i].x = (short)(SIN(angle) * len);
 		points[i].y = (short)(COS(angle) * len);
 	}
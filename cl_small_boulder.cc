@@ -42,10 +42,11 @@ void cl_small_boulder::reset()
 {
 	x = owner->x;
 	y = owner->y;
-	x_add = (random() % 5) - 2;
-	y_add = -5 - random() % 5;
+	x_add = (getRandom(RAND_GFX) % 5) - 2;
+	y_add = -5 - getRandom(RAND_GFX) % 5;
 
 	// Add small delay to start so boulders don't all start flying at same
 	// if we're being eaten
-	if (owner->stage == STAGE_BEING_EATEN) stage_cnt = -(random() % 50);
+	if (owner->stage == STAGE_BEING_EATEN)
+		stage_cnt = -(getRandom(RAND_GFX) % 50);
 }
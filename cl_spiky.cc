@@ -30,10 +30,10 @@ cl_spiky::cl_spiky(): cl_enemy(TYPE_SPIKY)
 void cl_spiky::activate()
 {
 	cl_tunnel *tun;
+	cl_object *obj;
 	int tnum;
 	int cnt;
 	int len;
-	int o;
 
 	cl_enemy::activate();
 
@@ -43,7 +43,7 @@ void cl_spiky::activate()
 	// Find a start location in a tunnel
 	do
 	{
-		switch(tunnels.size())
+		switch(game->tunnels.size())
 		{
 		case 0:
 			assert(0);
@@ -57,10 +57,11 @@ void cl_spiky::activate()
 			cnt = 0;
 			do
 			{
-				tnum = random() % tunnels.size();
-			} while(++cnt < 10 && tunnels[tnum] == player->curr_tunnel);
+				tnum = getRandom(RAND_GAME) % game->tunnels.size();
+			} while(++cnt < 10 &&
+			        game->tunnels[tnum] == game->player->curr_tunnel);
 		}
-		tun = tunnels[tnum];
+		tun = game->tunnels[tnum];
 
 		// Pick a random spot thats not in the middle of a boulder
 		cnt = 0;
@@ -70,28 +71,25 @@ void cl_spiky::activate()
 			{
 				x = tun->x1;
 				len = tun->max_y - tun->min_y - 2;
-				y = tun->min_y + (random() % len) + 1;
+				y = tun->min_y + 
+				    (getRandom(RAND_GAME) % len) + 1;
 			}
 			else
 			{
 				len = tun->max_x - tun->min_x - 2;
-				x = tun->min_x + (random() % len) + 1;
+				x = tun->min_x + 
+				    (getRandom(RAND_GAME) % len) + 1;
 				y = tun->y1;
 			}
-			for(o=0;o < MAX_OBJECTS;++o)
-			{
-				cl_object *obj = objects[o];
-				if (obj->type == TYPE_BOULDER &&
-				    obj->stage != STAGE_INACTIVE &&
-				    distToObject(obj) < obj->radius)
-					break;
-			}
-		} while(++cnt < 10 && o != MAX_OBJECTS);
+			for(obj=game->active_list[TYPE_BOULDER].head;
+			    obj && distToObject(obj) >= obj->radius;
+			    obj=obj->list_next);
+		} while(++cnt < 10 && obj);
 	// If this is try then we reached max loop count so pick new tunnel
-	} while(o != MAX_OBJECTS);
+	} while(obj);
 
-	speed = level < 20 ? 3 + 0.2 * level : 7;
-	lifespan = 400 + 20 * level;
+	speed = game->level < 20 ? 3 + 0.2 * game->level : 7;
+	lifespan = 400 + 20 * game->level;
 
 	setChangeDirCnt();
 	setMults();
@@ -119,7 +117,7 @@ void cl_spiky::attractActivate()
      simply bounce ff the walls. Also hopefully could get us unstuck. ***/
 void cl_spiky::setChangeDirCnt()
 {
-	change_dir_cnt = (random() % 130) + 20;
+	change_dir_cnt = (getRandom(RAND_GAME) % 130) + 20;
 }
 
 
@@ -131,16 +129,16 @@ void cl_spiky::setArmsForMaterialise()
 	bzero(arm,sizeof(arm));
 	for(int i=0;i < SPIKY_ARMS;++i)
 	{
-		arm[i].len = random() % MAX_ARM_LEN + 1;
-		arm[i].len_add = (double)(random() % 10 + 1) / 10;
-		arm[i].angle = random() % 360;
+		arm[i].len = getRandom(RAND_GFX) % MAX_ARM_LEN + 1;
+		arm[i].len_add = (double)(getRandom(RAND_GFX) % 10 + 1) / 10;
+		arm[i].angle = getRandom(RAND_GFX) % 360;
 
 		do
 		{
-			arm[i].ang_add = (random() % 11) - 5;
+			arm[i].ang_add = (getRandom(RAND_GFX) % 11) - 5;
 		} while(!arm[i].ang_add);
 
-		arm[i].col = start_col[random() % 6];
+		arm[i].col = start_col[getRandom(RAND_GFX) % 6];
 		arm[i].col_add = 0.1;
 	}
 }
@@ -153,11 +151,11 @@ void cl_spiky::setArmsForRun()
 {
 	for(int i=0;i < SPIKY_ARMS;++i)
 	{
-		arm[i].col = random() % COL_GREEN2;
+		arm[i].col = getRandom(RAND_GFX) % COL_GREEN2;
 
 		do
 		{
-			arm[i].col_add = (double)(random() % 30) / 10;
+			arm[i].col_add = (double)(getRandom(RAND_GFX) % 30) / 10;
 		} while(!arm[i].col_add);
 	}
 }
@@ -173,8 +171,8 @@ void cl_spiky::setMults()
 
 	do
 	{
-		xm = (random() % 2) ? -1 : 1;
-		ym = (random() % 2) ? -1 : 1;
+		xm = (getRandom(RAND_GAME) % 2) ? -1 : 1;
+		ym = (getRandom(RAND_GAME) % 2) ? -1 : 1;
 	} while(xm == x_mult && ym == y_mult);
 
 	x_mult = xm;
@@ -213,7 +211,7 @@ void cl_spiky::run()
 	case STAGE_EXPLODE:
 		if (stage_cnt == 1)
 		{
-			if (boulder) text_got_spiky->reset(this,0);
+			if (boulder) game->text_got_spiky->reset(this,0);
 		}
 		else if (stage_cnt == 40) setStage(STAGE_INACTIVE);
 		break;
@@ -248,12 +246,11 @@ void cl_spiky::stageRun()
 	int sy;
 	int ex;
 	int ey;
-	int x2;
-	int y2;
 	int add;
+	int dist;
 	int i;
 
-	if (player->freeze_timer) return;
+	if (game->player->freeze_timer) return;
 
 	if (hit_player)
 	{
@@ -270,7 +267,7 @@ void cl_spiky::stageRun()
 	{
 		for(i=0;i < SPIKY_ARMS;++i)
 		{
-			arm[i].col = start_col[random() % 6];
+			arm[i].col = start_col[getRandom(RAND_GFX) % 6];
 			arm[i].col_add = -0.1;
 		}
 		setStage(STAGE_DEMATERIALISE);
@@ -293,28 +290,18 @@ void cl_spiky::stageRun()
 	
 	// Check horizontal move for hit
 	add = (ex > sx ? 1 : -1);
-	for(x2=sx;;x2 += add)
+	if ((dist = wallDistX(sx,sy,add,abs(ex - sx))) != -1)
 	{
-		if (outsideTunnel(x2,sy))
-		{
-			x_mult = -x_mult;
-			x += (x2 - sx);
-			break;
-		}
-		if (x2 == ex) break;
+		x_mult = -x_mult;
+		x += dist * add;
 	}
 
 	// Check vertical
 	add = (ey > sy ? 1 : -1);
-	for(y2=sy;;y2 += add)
+	if ((dist = wallDistY(sx,sy,add,abs(ey - sy))) != -1)
 	{
-		if (outsideTunnel(sx,y2))
-		{
-			y_mult = -y_mult;
-			y += (y2 - sy);
-			break;
-		}
-		if (y2 == ey) break;
+		y_mult = -y_mult;
+		y += dist * add;
 	}
 
 	x += speed * x_mult;
@@ -356,7 +343,7 @@ void cl_spiky::haveCollided(cl_object *obj, double dist)
 		break;
 
 	case TYPE_PLAYER:
-		if (player->freeze_timer || hit_player) break;
+		if (game->player->freeze_timer || hit_player) break;
 
 		// Speed everything up to make it seem excited
 		for(int i=0;i < SPIKY_ARMS;++i)
@@ -395,7 +382,7 @@ void cl_spiky::draw()
 		ys = y + arm[i].len * COS(arm[i].angle) * ysize;
 
 		drawLine(
-			player->freeze_timer ? COL_MEDIUM_BLUE : (int)arm[i].col,
+			game->player->freeze_timer ? COL_MEDIUM_BLUE : (int)arm[i].col,
 			3,x,y,xs,ys);
 
 		arm[i].len += arm[i].len_add;
@@ -70,8 +70,8 @@ void cl_spooky::activate()
 	eye_col = COL_WHITE;
 	pup_col = COL_RED;
 
-	start_speed = speed = (level < 20 ? 2 + 0.2 * level : 6);
-	max_depth = level < 4 ? 2 + level : 6;
+	start_speed = speed = (game->level < 20 ? 2 + 0.2 * game->level : 6);
+	max_depth = game->level < 4 ? 2 + game->level : 6;
 
 	playFGSound(SND_ENEMY_MATERIALISE);
 }
@@ -98,6 +98,7 @@ void cl_spooky::attractActivate()
 /*** Call the appropriate behaviour ***/
 void cl_spooky::run()
 {
+	checkTunnelMerge();
 	++stage_cnt;
 	prev_x = x;
 	prev_y = y;
@@ -142,7 +143,7 @@ void cl_spooky::stageRun()
 	int ret;
 
 	// If frozen , do nothing
-	if (player->freeze_timer) return;
+	if (game->player->freeze_timer) return;
 
 	// This shouldn't happen but occasionally does due to some obscure
 	// bug. Cope with it.
@@ -164,15 +165,16 @@ void cl_spooky::stageRun()
 	}
 
 	// Speed up if turbo speed is on
-	if (player->turbo_enemy_timer)
+	if (game->player->turbo_enemy_timer)
 	{
 		if (speed == start_speed) speed = speed * 2;
 	}
 	else speed = start_speed;
 
 	// If we're in the same tunnel as player just head towards them
-	if (!player->invisible_timer && curr_tunnel == player->curr_tunnel) 
-		setDirectionToObject(player);
+	if (!game->player->invisible_timer &&
+	    curr_tunnel == game->player->curr_tunnel)
+		setDirectionToObject(game->player);
 	else if (next_tunnel)
 	{
 		setDirection();
@@ -180,12 +182,10 @@ void cl_spooky::stageRun()
 	}
 	// next_tunnel == NULL. 1 in 5 times pick a random new tunnel or if
 	// player is invisible
-	else if (!player->invisible_timer && random() % 5)
+	else if (!game->player->invisible_timer && getRandom(RAND_GAME) % 5)
 	{
-		if ((ret = findShortestPath(
-			0,
-			max_depth,
-			curr_tunnel,player->curr_tunnel,next_tunnel)) != -1)
+		if ((ret = findPathToPlayer(
+			max_depth,curr_tunnel,next_tunnel)) != -1)
 		{
 			setDirection();
 		}
@@ -276,7 +276,7 @@ void cl_spooky::haveCollided(cl_object *obj, double dist)
 
 	case TYPE_PLAYER:
 		// If frozen then do nothing
-		if (!player->freeze_timer)
+		if (!game->player->freeze_timer)
 		{
 			hit_player = true;
 			body_col = COL_RED;
@@ -302,17 +302,17 @@ void cl_spooky::draw()
 	{
 	case STAGE_MATERIALISE:
 		// Just flash
-		if ((game_stage_cnt % 4) < 2) return;
+		if ((game->game_stage_cnt % 4) < 2) return;
 		break;
 
 	case STAGE_RUN:
-		if (!(game_stage_cnt % 10)) bodynum = !bodynum;
-		bcol = player->freeze_timer ? COL_MEDIUM_BLUE : body_col;
+		if (!(game->game_stage_cnt % 10)) bodynum = !bodynum;
+		bcol = game->player->freeze_timer ? COL_MEDIUM_BLUE : body_col;
 		break;
 
 	case STAGE_HIT:
 		// Strobe eyes
-		if ((game_stage_cnt % 6) < 3)
+		if ((game->game_stage_cnt % 6) < 3)
 		{
 			eye_col = COL_RED;
 			pup_col = COL_WHITE;
@@ -326,8 +326,8 @@ void cl_spooky::draw()
 		// Shiver
 		if (stage_cnt < 40)
 		{
-			x += (random() % 10) - 5;
-			y += (random() % 10) - 5;
+			x += (getRandom(RAND_GFX) % 10) - 5;
+			y += (getRandom(RAND_GFX) % 10) - 5;
 			break;
 		}
 
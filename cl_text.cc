@@ -31,12 +31,12 @@ void cl_text::reset(cl_object *obj, int num)
 	{
 	case TXT_GOT_SPIKY:
 		text = "GOT SPIKY!";
-		cnt = random() % 10; // Random starting delay
+		cnt = getRandom(RAND_GFX) % 10; // Random starting delay
 		break;
 	case TXT_BONUS_SCORE:
 		sprintf(mesg,"BONUS %03d!",num);
 		text = mesg;
-		cnt = random() % 10; 
+		cnt = getRandom(RAND_GFX) % 10; 
 		break;
 	case TXT_INVISIBILITY_POWERUP:
 		text = "INVISIBILITY!";
@@ -224,7 +224,7 @@ void cl_text::draw()
 			ang_add = 0;
 		}
 
-		if (game_stage_cnt >= DIGGER_STOP)
+		if (game->game_stage_cnt >= DIGGER_STOP)
 		{
 			x = start_x;
 			y = SCR_MID - 40;
@@ -244,23 +244,24 @@ void cl_text::draw()
 		// Vibrate after bouncing
 		if (cnt)
 		{
-			x += ((random() % 21) - 10);
-			y += ((random() % 21) - 10);
+			x += ((getRandom(RAND_GFX) % 21) - 10);
+			y += ((getRandom(RAND_GFX) % 21) - 10);
 			--cnt;
 		}
 		break;
 
 	case TXT_COPYRIGHT:
-		if (game_stage_cnt < DIGGER_STOP) return;
+		if (game->game_stage_cnt < DIGGER_STOP) return;
 		break;
 
 	case TXT_S_TO_START:
-		if (game_stage_cnt < DIGGER_STOP || game_stage_cnt % 40 > 20)
+		if (game->game_stage_cnt < DIGGER_STOP ||
+		    game->game_stage_cnt % 40 > 20)
 			return;
 		break;
 
 	case TXT_LEVEL_START:
-		sprintf(txt,"LEVEL %02d",level);
+		sprintf(txt,"LEVEL %02d",game->level);
 		text = txt;
 		if (angle >= 350)
 		{
@@ -270,8 +271,8 @@ void cl_text::draw()
 		break;		
 
 	case TXT_READY:
-		incAngle(angle,10 - abs(20 - (game_stage_cnt % 40)));
-		thick = 15 - abs(10 - (game_stage_cnt % 20));
+		incAngle(angle,10 - abs(20 - (game->game_stage_cnt % 40)));
+		thick = 15 - abs(10 - (game->game_stage_cnt % 20));
 		col = ((int)col + 5) % COL_GREEN2;
 		break;
 
@@ -314,7 +315,8 @@ void cl_text::draw()
 			dist += 2;
 		}
 		else y -= 20;
-		if (type == TXT_GOT_SPIKY) col = random() % NUM_FULL_COLOURS;
+		if (type == TXT_GOT_SPIKY)
+			col = getRandom(RAND_GFX) % NUM_FULL_COLOURS;
 		else
 		{
 			if (col == COL_YELLOW || col == COL_BLUE) col_add = -1;
@@ -354,7 +356,7 @@ void cl_text::draw()
 		y -= y_add;
 		y_add += 0.3;
 
-		if ((game_stage_cnt % 4) < 2) return;
+		if ((game->game_stage_cnt % 4) < 2) return;
 		break;
 
 	case TXT_SUPERBALL_POWERUP:
@@ -369,7 +371,7 @@ void cl_text::draw()
 		y -= y_add;
 		y_add += 0.3;
 
-		col = random() % NUM_FULL_COLOURS;
+		col = getRandom(RAND_GFX) % NUM_FULL_COLOURS;
 		break;
 
 	case TXT_FREEZE_POWERUP:
@@ -384,7 +386,7 @@ void cl_text::draw()
 		y_add += 0.3;
 
 		x -= 5;
-		thick = 5 + random() % 30;
+		thick = 5 + getRandom(RAND_GFX) % 30;
 		if (--col == COL_TURQUOISE) col = COL_BLUE;
 		break;
 
@@ -394,9 +396,10 @@ void cl_text::draw()
 			running = false;
 			return;
 		}
-		col = random() % NUM_FULL_COLOURS;
+		col = getRandom(RAND_GFX) % NUM_FULL_COLOURS;
 		x -= 10;
-		y = SCR_MID + SIN((game_stage_cnt * 4) % 360) * SCR_MID * 0.8;
+		y = SCR_MID +
+		    SIN((game->game_stage_cnt * 4) % 360) * SCR_MID * 0.8;
 		break;
 
 	default:
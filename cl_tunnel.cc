@@ -10,7 +10,9 @@ cl_tunnel::cl_tunnel(int nx1, int ny1)
 	min_y = y1 - TUNNEL_HALF;
 	max_y = y1 + TUNNEL_HALF;
 	vert = true;
-	recursed = false;
+	id = -1;
+	slot = -1;
+	indexed = false;
 }
 
 
@@ -29,11 +31,10 @@ void cl_tunnel::update(int nx2, int ny2)
 
 
 /*** Tunnel is now complete. If we're on the same route as a previous tunnel
-     then remove from list ***/
+     then remove from list and return that tunnel ***/
 cl_tunnel *cl_tunnel::complete()
 {
 	cl_tunnel *tun;
-	cl_enemy *mon;
 
 	// If no simmilar tunnels just link us to other tunnels
 	if (!(tun = checkForSimilar())) 
@@ -45,41 +46,21 @@ cl_tunnel *cl_tunnel::complete()
 
 	// If we're here we're on the route of another tunnel and will be
 	// deleted. We'll be last on the list so can just pop
-	tunnels.pop_back();
+	game->tunnels.pop_back();
+	unindexTunnel(this);
+	invalidatePaths();
 
-	if (player->prev_tunnel) 
+	if (game->player->prev_tunnel) 
 	{
-		assert(*(player->prev_tunnel->links.rbegin()) == this);
-		player->prev_tunnel->links.pop_back();
+		assert(*(game->player->prev_tunnel->links.rbegin()) == this);
+		game->player->prev_tunnel->links.pop_back();
+		game->player->prev_tunnel->link_set.erase(this);
 	}
 	tun->setMaxMin();
 	tun->setLinks();
 
-	// Tell appropriate objects to update their tunnel pointers
-	for(auto obj: objects)
-	{
-		if (obj->stage == STAGE_INACTIVE) continue;
-
-		switch(obj->type)
-		{
-		case TYPE_PLAYER:
-		case TYPE_BALL:
-		case TYPE_NUGGET:
-		case TYPE_BOULDER:
-		case TYPE_SPIKY:
-			break;
-
-		case TYPE_SPOOKY:
-		case TYPE_GRUBBLE:
-		case TYPE_WURMAL:
-			mon = (cl_enemy *)obj;
-			mon->updateTunnelPtrs(this,tun);
-			break;
-
-		default:
-			assert(0);
-		}
-	}
+	// Caller calls mergeTunnel() to get rid of us which moves all the 
+	// handles onto tun
 	return tun;
 }
 
@@ -89,9 +70,9 @@ cl_tunnel *cl_tunnel::complete()
 /*** Find a tunnel we're simply another part of  - we then extend that ***/
 cl_tunnel *cl_tunnel::checkForSimilar()
 {
-	for(auto tun: tunnels)
+	for(auto tun: collinearTunnels(vert,vert ? x1 : y1))
 	{
-		if (tun == this || vert != tun->vert) continue;
+		if (tun == this) continue;
 
 		// If we're a continuation of a tunnel just update that
 		// tunnel and delete this one
@@ -184,22 +165,25 @@ void cl_tunnel::setMaxMin()
 			if (x1 + TUNNEL_HALF > max_x) max_x = x1 + TUNNEL_HALF;
 		}
 	}
+	indexTunnel(this);
 }
 
 
 
 
-/*** Link us to any other tunnels that we overlap ***/
+/*** Link us to any other tunnels that we overlap. Only tunnels near us in
+     the index can overlap. ***/
 void cl_tunnel::setLinks()
 {
-	vector<cl_tunnel *>::iterator it;
+	static thread_local vector<cl_tunnel *> near;
 	int xlen;
 	int ylen;
 
-	for(auto tun: tunnels)
+	nearTunnels(this,near);
+
+	for(auto tun: near)
 	{
-		if (tun != this && 
-		    find(links.begin(),links.end(),tun) == links.end())
+		if (link_set.find(tun) == link_set.end())
 		{
 			/* Both overlaps must be > 0 and at least one must
 			   be >= TUNNEL_WIDTH otherwise enemies would move
@@ -220,7 +204,10 @@ void cl_tunnel::setLinks()
 void cl_tunnel::linkTunnel(cl_tunnel *tun)
 {
 	links.push_back(tun);
+	link_set.insert(tun);
 	tun->links.push_back(this);
+	tun->link_set.insert(this);
+	invalidatePaths();
 }
 
 
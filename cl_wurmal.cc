@@ -23,6 +23,7 @@ cl_wurmal::cl_wurmal(): cl_enemy(TYPE_WURMAL)
 /*** Set up the start location and segments ***/
 void cl_wurmal::activate()
 {
+	cl_object *obj;
 	int xmod = SCR_SIZE - diam;
 	int ymod = PLAY_AREA_HEIGHT - diam;
 	int i;
@@ -39,8 +40,8 @@ void cl_wurmal::activate()
 	j = 0;
 	do
 	{
-		x = (random() % xmod) + radius;
-		y = PLAY_AREA_TOP + (random() % ymod) + radius;
+		x = (getRandom(RAND_GAME) % xmod) + radius;
+		y = PLAY_AREA_TOP + (getRandom(RAND_GAME) % ymod) + radius;
 	} while(++j < 20 && 
 	        (outsideGround(x,y) ||
 	         outsideGround(x-head_radius,y) ||
@@ -51,22 +52,16 @@ void cl_wurmal::activate()
 
 	if (j == 20) return; 
 
-	for(auto obj: objects)
+	for(auto t: { TYPE_NUGGET, TYPE_BOULDER })
 	{
-		switch(obj->type)
+		for(obj=game->active_list[t].head;obj;obj=obj->list_next)
 		{
-		case TYPE_NUGGET:
-		case TYPE_BOULDER:
 			if (obj->stage == STAGE_RUN &&
 			    cl_object::overlapDist(obj))
 			{
 				if (++i == 10) return;
 				goto LOOP;
 			}
-			break;
-
-		default:
-			break;
 		}
 	}
 
@@ -82,10 +77,10 @@ void cl_wurmal::activate()
 
 	initSegments();
 
-	if (level < 10)
+	if (game->level < 10)
 	{
-		speed = 0.8 + 0.1 * level;
-		eating_time = 200 - level * 10;
+		speed = 0.8 + 0.1 * game->level;
+		eating_time = 200 - game->level * 10;
 	}
 	else
 	{
@@ -93,6 +88,10 @@ void cl_wurmal::activate()
 		eating_time = 100;
 	}
 
+	// Room needed round the head centre so the head edge never goes into
+	// a tunnel whichever way we're going
+	clearance = head_radius + (int)ceil(speed) + 1;
+
 	start_y = y;
 	y = -diam;
 
@@ -158,7 +157,7 @@ void cl_wurmal::run()
 		if (stage_cnt == 20)
 		{
 			setStage(STAGE_INACTIVE);
-			++wurmals_killed;
+			++game->wurmals_killed;
 		}
 		break;
 
@@ -194,7 +193,7 @@ void cl_wurmal::stageRun()
 	}
 
 	// If frozen do nothing
-	if (player->freeze_timer) return;
+	if (game->player->freeze_timer) return;
 
 	// Just do some animation while eating
 	if (eating)
@@ -216,35 +215,10 @@ void cl_wurmal::stageRun()
 			return;
 		}
 
-		// This monster doesn't use directions as it can go in a
-		// diagonal line.
-		if (fabs(x - nugget->x) > radius)
-			x_add = nugget->x < x ? -1 : (nugget->x > x ? 1 : 0);
-		else
-			x_add = 0;
-
-		if (fabs(y - nugget->y) > radius)
-			y_add = nugget->y < y ? -1 : (nugget->y > y ? 1 : 0);
-		else
-			y_add = 0;
-
-		updateEyeAngle();
-		updateEdges();
+		// Go round any tunnels until we're next to it
+		if (!followPath()) headForNugget();
 
-		// Avoid tunnels and the edge of the screen
-		if (outsideGround(x_edge,y_edge))
-		{
-			if (outsideGround(x_edge,y_edge)) x_add = y_add = 0;
-			else
-			{
-				if (outsideGround(x_edge,y)) x_add = 0;
-				if (outsideGround(x,y_edge)) y_add = 0;
-			}
-			updateEyeAngle();
-			updateEdges();
-		}
-
-		// Can't head in nugget direction, try a random move.
+		// Can't get to the nugget, try a random move.
 		if (!x_add & !y_add)
 		{
 			nugget = NULL;
@@ -290,23 +264,32 @@ void cl_wurmal::stageRun()
 
 
 
-/*** Find the nugget nearest to us or just a random one. Hopefully it won't be 
-     across a tunnel ***/
+/*** Find the nugget nearest to us or just a random one out of those we can 
+     get to without crossing a tunnel. Distance is how far we'd have to go
+     round through the ground, not as the crow flies. ***/
 void cl_wurmal::findNugget()
 {
+	static thread_local short reach[GROUND_CELLS];
+	static thread_local vector<int> cells;
 	cl_nugget *nug;
+	cl_object *obj;
 	cl_object *closest;
-	double closest_dist;
-	double dist;
+	int closest_dist;
+	int dist;
+	int cell;
 
 	nugget = NULL;
+	if ((cell = groundCell(x,y)) == -1) return;
+
+	cells.assign(1,cell);
+	groundDistances(cells,clearance,reach);
+
 	closest = NULL;
-	closest_dist = FAR_FAR_AWAY;
+	closest_dist = GROUND_CELLS;
 
-	for(auto obj: objects)
+	for(obj=game->active_list[TYPE_NUGGET].head;obj;obj=obj->list_next)
 	{
-		if (obj->type == TYPE_NUGGET && 
-		    obj->stage == STAGE_RUN)
+		if (obj->stage == STAGE_RUN)
 		{
 			nug = (cl_nugget *)obj;
 
@@ -324,46 +307,206 @@ void cl_wurmal::findNugget()
 
 			default:
 				// Don't eat powerups at lower levels
-				if (level < 6) continue;
+				if (game->level < 6) continue;
+			}
+
+			// Nearest we can get to it
+			nuggetCells(obj,cells);
+			dist = -1;
+			for(auto c: cells)
+			{
+				if (reach[c] != -1 && (dist == -1 || reach[c] < dist))
+					dist = reach[c];
 			}
+			if (dist == -1) continue;
 
 			if (find_random_nugget)
 			{
-				nugget = obj;
-				return;
+				closest = obj;
+				break;
 			}
-			if ((dist = distToObject(obj)) < closest_dist)
+			if (dist < closest_dist)
 			{
 				closest_dist = dist;
 				closest = obj;
 			}
 		}
 	}
-	nugget = closest;
+	if ((nugget = closest)) buildPath();
 }
 
 
 
 
-/*** Pick a random move that doesn't send us into a tunnel ***/
+/*** The cells we could be in and still reach the nugget with our head ***/
+void cl_wurmal::nuggetCells(cl_object *nug, vector<int> &cells)
+{
+	size_t i;
+	size_t j;
+
+	// Less a cell as we could be anywhere in it
+	groundCellsNear(
+		nug->x,nug->y,head_radius + nug->radius - GROUND_CELL,cells);
+
+	for(i=j=0;i < cells.size();++i)
+	{
+		if (groundClearance(cells[i]) >= clearance) cells[j++] = cells[i];
+	}
+	cells.resize(j);
+}
+
+
+
+
+/*** Work out how far every cell is from the nugget ***/
+void cl_wurmal::buildPath()
+{
+	static thread_local vector<int> cells;
+
+	nuggetCells(nugget,cells);
+	groundDistances(cells,clearance,path);
+}
+
+
+
+
+/*** Head for the next cell nearer the nugget. Returns false if we're next to
+     it already. If the way's been dug through since the path was worked out
+     then work it out again and if there's still no way then stop. ***/
+bool cl_wurmal::followPath()
+{
+	int cell;
+
+	if ((cell = groundCell(x,y)) == -1 || !path[cell]) return false;
+
+	if (!downhill(cell))
+	{
+		buildPath();
+		if (!path[cell]) return false;
+		downhill(cell);
+	}
+	updateEyeAngle();
+	updateEdges();
+	return true;
+}
+
+
+
+
+/*** Set the direction to the neighbouring cell nearest the nugget if it's 
+     nearer than this one. Returns false if there isn't one. ***/
+bool cl_wurmal::downhill(int cell)
+{
+	int best = path[cell] == -1 ? GROUND_CELLS : path[cell];
+	int dist;
+	int dx;
+	int dy;
+
+	x_add = 0;
+	y_add = 0;
+
+	for(dy=-1;dy <= 1;++dy)
+	{
+		for(dx=-1;dx <= 1;++dx)
+		{
+			if ((dx || dy) &&
+			    groundStepOK(cell,dx,dy,clearance) &&
+			    (dist = path[groundNeighbour(cell,dx,dy)]) != -1 &&
+			    dist < best)
+			{
+				best = dist;
+				x_add = dx;
+				y_add = dy;
+			}
+		}
+	}
+	return x_add || y_add;
+}
+
+
+
+
+/*** Go straight for the nugget once we're next to it ***/
+void cl_wurmal::headForNugget()
+{
+	// This monster doesn't use directions as it can go in a
+	// diagonal line.
+	if (fabs(x - nugget->x) > radius)
+		x_add = nugget->x < x ? -1 : (nugget->x > x ? 1 : 0);
+	else
+		x_add = 0;
+
+	if (fabs(y - nugget->y) > radius)
+		y_add = nugget->y < y ? -1 : (nugget->y > y ? 1 : 0);
+	else
+		y_add = 0;
+
+	updateEyeAngle();
+	updateEdges();
+
+	// Avoid tunnels and the edge of the screen
+	if (outsideGround(x_edge,y_edge))
+	{
+		if (outsideGround(x_edge,y_edge)) x_add = y_add = 0;
+		else
+		{
+			if (outsideGround(x_edge,y)) x_add = 0;
+			if (outsideGround(x,y_edge)) y_add = 0;
+		}
+		updateEyeAngle();
+		updateEdges();
+	}
+}
+
+
+
+
+/*** Pick a random move out of the directions with room for the head ***/
 void cl_wurmal::pickRandomMove()
 {
-	int i = 0;
+	int dirs[8][2];
+	int cnt = 0;
+	int cell;
+	int dx;
+	int dy;
+	int i;
 
-	random_move_cnt = 50 + random() % 50;
+	random_move_cnt = 50 + getRandom(RAND_GAME) % 50;
 	find_random_nugget = !find_random_nugget;
 
-	do
+	if ((cell = groundCell(x,y)) != -1)
+	{
+		for(dy=-1;dy <= 1;++dy)
+		{
+			for(dx=-1;dx <= 1;++dx)
+			{
+				if ((dx || dy) && groundStepOK(cell,dx,dy,clearance))
+				{
+					dirs[cnt][0] = dx;
+					dirs[cnt][1] = dy;
+					++cnt;
+				}
+			}
+		}
+	}
+
+	if (cnt)
 	{
+		i = getRandom(RAND_GAME) % cnt;
+		x_add = dirs[i][0];
+		y_add = dirs[i][1];
+	}
+	else
+	{
+		// Boxed in. Might still be able to squeeze out somewhere.
 		do 
 		{
-			x_add = (random() % 3) - 1;
-			y_add = (random() % 3) - 1;
+			x_add = (getRandom(RAND_GAME) % 3) - 1;
+			y_add = (getRandom(RAND_GAME) % 3) - 1;
 		} while (!x_add && !y_add);
+	}
 
-		updateEdges();
-	} while(++i < 10 && outsideGround(x_edge,y_edge));
-
+	updateEdges();
 	updateEyeAngle();
 }
 
@@ -419,7 +562,10 @@ void cl_wurmal::updateSegments()
 /*** Returns true if we're not in the dirt ***/
 bool cl_wurmal::outsideGround(double x, double y)
 {
-	return offscreen((int)x,(int)y) || !tunnel_bitmap[(int)x][(int)y];
+	int ix = (int)x;
+	int iy = (int)y;
+
+	return !ONSCREEN(ix,iy) || !IS_GROUND(ix,iy);
 }
 
 
@@ -454,7 +600,7 @@ void cl_wurmal::haveCollided(cl_object *obj, double dist)
 
 	case TYPE_PLAYER:
 		// If player has hit us when invisible then die
-		if (player->invisible_timer || player->freeze_timer)
+		if (game->player->invisible_timer || game->player->freeze_timer)
 		{
 			incScore(400);
 			setStage(STAGE_HIT);
@@ -494,6 +640,26 @@ double cl_wurmal::overlapDist(cl_object *obj)
 
 
 
+/*** Has to cover all the segments ***/
+double cl_wurmal::boundRadius()
+{
+	double bound = 0;
+	double dist;
+	int rad;
+	int i;
+
+	for(i=0;i < WURMAL_SEGMENTS;++i)
+	{
+		rad = i ? radius : head_radius;
+		dist = hypot(segment[i].x - x,segment[i].y - y) + rad;
+		if (dist > bound) bound = dist;
+	}
+	return bound;
+}
+
+
+
+
 /*** Draw all the segments - draw last first ***/
 void cl_wurmal::draw()
 {
@@ -507,14 +673,15 @@ void cl_wurmal::draw()
 
 	case STAGE_RUN:
 		hd = eating ? 
-		     head_diam + (head_diam - abs((game_stage_cnt * 2 % head_diam * 2) - head_diam)) / 2 : 
+		     head_diam + (head_diam - abs((game->game_stage_cnt * 2 %
+		     head_diam * 2) - head_diam)) / 2 : 
 		     head_diam;
 		break;
 
 	case STAGE_HIT:
 		xsize -= 0.03;
 		ysize -= 0.03;
-		eye_col = (game_stage_cnt % 2) ? COL_BLACK2 : COL_RED2;
+		eye_col = (game->game_stage_cnt % 2) ? COL_BLACK2 : COL_RED2;
 		hd = head_diam * xsize;
 		break;
 
@@ -542,7 +709,7 @@ void cl_wurmal::draw()
 
 	// Draw head
 	objDrawOrFillCircle(
-		player->freeze_timer ? COL_MEDIUM_BLUE : COL_PURPLE,
+		game->player->freeze_timer ? COL_MEDIUM_BLUE : COL_PURPLE,
 		4,hd,0,0,fill);
 	objDrawOrFillCircle(eye_col,4,10,eye_x[0]*xsize,eye_y[0]*ysize,fill);
 	objDrawOrFillCircle(eye_col,4,10,eye_x[1]*xsize,eye_y[1]*ysize,fill);
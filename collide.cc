@@ -0,0 +1,251 @@
+// Collision detection between objects. A uniform grid is built each tick so
+// only objects near each other get the full overlap test.
+
+#include "globals.h"
+
+#define GRID_CELL_SIZE TUNNEL_WIDTH
+#define GRID_CELLS     ((SCR_SIZE + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE)
+
+/* haveCollided() can move an object a little during the pass. eg the player
+   is put back where it was last tick if it hits a boulder and the boulder
+   gets pushed. Boxes are made this much bigger to allow for it. */
+#define GRID_MARGIN 5
+
+#define Y true
+#define N false
+
+/* Whether the row type's haveCollided() does anything when it hits the
+   column type. Has to be kept in step with the haveCollided() functions. 
+   Stones and small boulders are never in the objects list. */
+static constexpr bool reacts[NUM_TYPES][NUM_TYPES] =
+{
+	//             PLY BAL STN NUG BLD SBL SPO SPI GRU WUR
+	/* PLAYER  */ { N,  N,  N,  Y,  Y,  N,  Y,  Y,  Y,  Y },
+	/* BALL    */ { Y,  N,  N,  N,  Y,  N,  Y,  Y,  Y,  Y },
+	/* STONE   */ { N,  N,  N,  N,  N,  N,  N,  N,  N,  N },
+	/* NUGGET  */ { Y,  N,  N,  N,  N,  N,  N,  N,  N,  Y },
+	/* BOULDER */ { N,  N,  N,  N,  Y,  N,  Y,  N,  Y,  Y },
+	/* SMALL B */ { N,  N,  N,  N,  N,  N,  N,  N,  N,  N },
+	/* SPOOKY  */ { Y,  Y,  N,  N,  Y,  N,  N,  N,  N,  N },
+	/* SPIKY   */ { Y,  Y,  N,  N,  Y,  N,  N,  N,  N,  N },
+	/* GRUBBLE */ { Y,  Y,  N,  N,  Y,  N,  N,  N,  N,  N },
+	/* WURMAL  */ { Y,  N,  N,  Y,  Y,  N,  N,  N,  N,  N }
+};
+
+#undef Y
+#undef N
+
+// A pair only needs testing if either side cares
+static constexpr bool pairMatters(en_type t1, en_type t2)
+{
+	return reacts[t1][t2] || reacts[t2][t1];
+}
+
+static_assert(!pairMatters(TYPE_NUGGET,TYPE_NUGGET),"Nugget table error");
+static_assert(!pairMatters(TYPE_NUGGET,TYPE_SPOOKY),"Nugget table error");
+static_assert(!pairMatters(TYPE_BOULDER,TYPE_NUGGET),"Boulder table error");
+static_assert(pairMatters(TYPE_BALL,TYPE_PLAYER),"Ball table error");
+static_assert(pairMatters(TYPE_WURMAL,TYPE_NUGGET),"Wurmal table error");
+
+// Objects that could collide at the start of the pass in objects[] order
+static thread_local cl_object *coll[MAX_OBJECTS];
+static thread_local int num_coll;
+
+// Indexes into coll in each cell. An object goes in every cell its box 
+// touches.
+static thread_local vector<int> grid[GRID_CELLS][GRID_CELLS];
+
+// Cells each object in coll was put in
+static thread_local struct st_grid_box
+{
+	int cx1;
+	int cy1;
+	int cx2;
+	int cy2;
+} grid_box[MAX_OBJECTS];
+
+// Objects to test against the current one
+static thread_local vector<int> cand;
+
+// Stops an object being tested twice when it shares more than one cell
+static thread_local int checked[MAX_OBJECTS];
+static thread_local int check_stamp;
+
+// Pair counts per tick
+static thread_local u_long ticks;
+static thread_local u_long total_pairs;
+static thread_local u_long total_skipped;
+static thread_local int max_skipped;
+
+static bool canCollide(cl_object *obj);
+static void buildGrid();
+static int gridCell(double v);
+static void checkPair(cl_object *obj1, cl_object *obj2);
+
+
+/*** Test every pair of objects that could be touching. Pairs are done in the
+     same order as a straight loop over all pairs would do them so each
+     object's haveCollided() sees the same sequence of collisions. ***/
+void checkCollisions()
+{
+	st_grid_box *box;
+	cl_object *obj1;
+	cl_object *obj2;
+	int skipped = 0;
+	int o;
+	int cx;
+	int cy;
+
+	buildGrid();
+
+	for(o=0;o < num_coll-1;++o)
+	{
+		obj1 = coll[o];
+		if (!canCollide(obj1)) continue;
+
+		// Get everything after us in the list that shares a cell
+		++check_stamp;
+		cand.clear();
+		box = &grid_box[o];
+
+		for(cy=box->cy1;cy <= box->cy2;++cy)
+		{
+			for(cx=box->cx1;cx <= box->cx2;++cx)
+			{
+				for(auto i: grid[cy][cx])
+				{
+					if (i > o && checked[i] != check_stamp)
+					{
+						checked[i] = check_stamp;
+						cand.push_back(i);
+					}
+				}
+			}
+		}
+		sort(cand.begin(),cand.end());
+
+		// Other object's stage is checked at the point it's tested as
+		// it may have just changed in an earlier haveCollided()
+		for(auto p: cand)
+		{
+			obj2 = coll[p];
+			if (!pairMatters(obj1->type,obj2->type)) ++skipped;
+			else if (canCollide(obj2)) checkPair(obj1,obj2);
+		}
+		total_pairs += cand.size();
+	}
+
+	++ticks;
+	total_skipped += skipped;
+	if (skipped > max_skipped) max_skipped = skipped;
+}
+
+
+
+
+/*** Print how many pairs got past the grid and how many of those the type
+     table threw out ***/
+void collideReport()
+{
+	if (!ticks) return;
+
+	printf("Collision pairs: %.1f/tick near, %.1f/tick skipped by type "
+	       "(max %d), %.1f%% skipped\n",
+		(double)total_pairs / ticks,
+		(double)total_skipped / ticks,
+		max_skipped,
+		total_pairs ? 100.0 * total_skipped / total_pairs : 0);
+}
+
+
+
+
+bool canCollide(cl_object *obj)
+{
+	switch(obj->stage)
+	{
+	case STAGE_RUN:
+	case STAGE_WOBBLE:
+	case STAGE_FALL:
+	case STAGE_BEING_EATEN:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+
+
+
+/*** Put every object that can collide into the cells covered by a box
+     around it. Two objects can only touch if their boxes share a cell. Only
+     objects that can collide at the start of the pass go in as haveCollided()
+     never makes an object collidable again. ***/
+void buildGrid()
+{
+	st_grid_box *box;
+	cl_object *obj;
+	double rad;
+	int o;
+	int cx;
+	int cy;
+
+	for(cy=0;cy < GRID_CELLS;++cy)
+		for(cx=0;cx < GRID_CELLS;++cx) grid[cy][cx].clear();
+
+	num_coll = 0;
+	for(obj=firstActiveObject();obj;obj=nextActiveObject(obj))
+	{
+		if (!canCollide(obj)) continue;
+
+		o = num_coll++;
+		coll[o] = obj;
+		rad = obj->boundRadius() + GRID_MARGIN;
+		box = &grid_box[o];
+		box->cx1 = gridCell(obj->x - rad);
+		box->cy1 = gridCell(obj->y - rad);
+		box->cx2 = gridCell(obj->x + rad);
+		box->cy2 = gridCell(obj->y + rad);
+
+		for(cy=box->cy1;cy <= box->cy2;++cy)
+		{
+			for(cx=box->cx1;cx <= box->cx2;++cx)
+				grid[cy][cx].push_back(o);
+		}
+	}
+}
+
+
+
+
+/*** Anything off the screen goes in the edge cells ***/
+int gridCell(double v)
+{
+	int c = (int)floor(v / GRID_CELL_SIZE);
+
+	if (c < 0) return 0;
+	if (c >= GRID_CELLS) return GRID_CELLS - 1;
+	return c;
+}
+
+
+
+
+void checkPair(cl_object *obj1, cl_object *obj2)
+{
+	double dist;
+
+	// Wurmal is special case - must always use its overloaded version of
+	// function
+	if (obj2->type == TYPE_WURMAL)
+		dist = obj2->overlapDist(obj1);
+	else
+		dist = obj1->overlapDist(obj2);
+
+	if (dist)
+	{
+		obj1->haveCollided(obj2,dist);
+		obj2->haveCollided(obj1,dist);
+	}
+}
@@ -4,13 +4,40 @@
 
 void resetMolehills();
 
+/*** Fill the state of every random stream from the one seed using 
+     splitmix64 which is what the xoshiro authors suggest ***/
+void seedRandom(uint64_t seed)
+{
+	uint64_t z;
+	int st;
+	int i;
+
+	game->rand_seed = seed;
+	for(st=0;st < NUM_RAND_STREAMS;++st)
+	{
+		for(i=0;i < 4;++i)
+		{
+			z = (seed += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			game->rand_state[st][i] = z ^ (z >> 31);
+		}
+	}
+}
+
+
+
+
 /*** Stages are changed in mainloop() and cl_player::run() ***/
 void setGameStage(en_game_stage stg)
 {
+	cl_object *obj;
+	cl_object *next;
 	int i;
+	int t;
 
-	game_stage = stg;
-	game_stage_cnt = 0;
+	game->game_stage = stg;
+	game->game_stage_cnt = 0;
 
 	// Should be no background sounds after stage reset
 	playBGSound(SND_SILENCE);
@@ -20,22 +47,22 @@ void setGameStage(en_game_stage stg)
 	case GAME_STAGE_ATTRACT_PLAY:
 		resetMolehills();
 		setScore(0);
-		text_digger->reset();
-		text_copyright->reset();
-		text_s_to_start->reset();
+		game->text_digger->reset();
+		game->text_copyright->reset();
+		game->text_s_to_start->reset();
 		deactivateAllObjects();
-		level = random() % 20 + 1;
+		game->level = getRandom(RAND_GAME) % 20 + 1;
 		initLevel();
-		player->activate();
+		game->player->activate();
 		break;
 
 	case GAME_STAGE_ATTRACT_ENEMIES:
 		// Resets freeze counts etc so enemies in this screen have
 		// correct colour
-		player->activate(); 
+		game->player->activate(); 
 
 		for(i=0;i < NUM_ATTRACT_ENEMIES;++i)
-			attract_enemy[i]->attractActivate();
+			game->attract_enemy[i]->attractActivate();
 		break;
 
 	case GAME_STAGE_ATTRACT_KEYS:
@@ -45,53 +72,49 @@ void setGameStage(en_game_stage stg)
 		resetMolehills();
 		deactivateAllObjects();
 		initLevel();
-		text_level_start->reset();
+		game->text_level_start->reset();
 		break;
 
 	case GAME_STAGE_READY:
-		text_ready->reset();
+		game->text_ready->reset();
 		break;
 
 	case GAME_STAGE_PLAY:
-		player->activate();
+		game->player->activate();
 		break;
 
 	case GAME_STAGE_LEVEL_COMPLETE:
 		// Bonus score if no lives lost during level
-		if (lives == lives_at_level_start)
+		if (game->lives == game->lives_at_level_start)
 		{
-			end_of_level_bonus = 200 + 100 * level;
-			incScore(end_of_level_bonus);
+			game->end_of_level_bonus = 200 + 100 * game->level;
+			incScore(game->end_of_level_bonus);
 		}
-		else end_of_level_bonus = 0;
-		sprintf(end_of_level_bonus_str,"BONUS: %04d\n",end_of_level_bonus);
+		else game->end_of_level_bonus = 0;
+		sprintf(game->end_of_level_bonus_str,
+			"BONUS: %04d\n",game->end_of_level_bonus);
 		break;
 
 	case GAME_STAGE_PLAYER_DIED:
-		setLives(lives-1);
-		if (!lives)
+		setLives(game->lives-1);
+		if (!game->lives)
 		{
-			game_stage = GAME_STAGE_GAME_OVER;
-			text_game_over->reset();	
+			game->game_stage = GAME_STAGE_GAME_OVER;
+			game->text_game_over->reset();	
 			playFGSound(SND_GAME_OVER);
 		}
 
 		// Reset all objects except boulders and nuggets which stay
 		// in STAGE_RUN unless boulder is being eaten
-		for(auto obj: objects)
+		for(t=0;t < NUM_TYPES;++t)
 		{
-			switch(obj->type)
-			{
-			case TYPE_NUGGET:
-				break;
+			if (t == TYPE_NUGGET) continue;
 
-			case TYPE_BOULDER:
-				if (obj->stage == STAGE_BEING_EATEN)
+			for(obj=game->active_list[t].head;obj;obj=next)
+			{
+				next = obj->list_next;
+				if (t != TYPE_BOULDER || obj->stage == STAGE_BEING_EATEN)
 					obj->setStage(STAGE_INACTIVE);
-				break;
-
-			default:
-				obj->setStage(STAGE_INACTIVE);
 			}
 		}
 		break;
@@ -107,7 +130,7 @@ void setGameStage(en_game_stage stg)
 /*** Pick new position , width and height ***/
 void resetMolehills()
 {
-	for(int i=0;i < NUM_MOLEHILLS;++i) molehill[i].reset();
+	for(int i=0;i < NUM_MOLEHILLS;++i) game->molehill[i].reset();
 }
 
 
@@ -116,32 +139,33 @@ void resetMolehills()
 /*** Set up the level specific stuff ***/
 void initLevel()
 {
-	level_cnt = 0;
-
-	materialise_y_add = level < 10 ? 1 + (double)level / 10 : 2;
-	spooky_create_mod = level < 10 ? 300 - level * 20 : 100;
-	grubble_create_mod = level < 15 ? 250 - level * 10 : 100;
-	first_spooky_cnt = level < 10 ? 40 - level * 2 : 20;
-	eating_time = level < 10 ? 100 - level * 5 : 50;
-	bonus_nugget_cnt = (level < 6 ? 1 : 2);
-
-	nugget_cnt = 0;
-	invisible_powerup_cnt = 0;
-	superball_powerup_cnt = 0;
-	turbo_enemy_powerup_cnt = 0;
-	freeze_powerup_cnt = 0;
+	game->level_cnt = 0;
+
+	game->materialise_y_add =
+		game->level < 10 ? 1 + (double)game->level / 10 : 2;
+	game->spooky_create_mod = game->level < 10 ? 300 - game->level * 20 : 100;
+	game->grubble_create_mod = game->level < 15 ? 250 - game->level * 10 : 100;
+	game->first_spooky_cnt = game->level < 10 ? 40 - game->level * 2 : 20;
+	game->eating_time = game->level < 10 ? 100 - game->level * 5 : 50;
+	game->bonus_nugget_cnt = (game->level < 6 ? 1 : 2);
+
+	game->nugget_cnt = 0;
+	game->invisible_powerup_cnt = 0;
+	game->superball_powerup_cnt = 0;
+	game->turbo_enemy_powerup_cnt = 0;
+	game->freeze_powerup_cnt = 0;
 
 	// Once wurmals killed on a level they stay dead
-	wurmals_killed = 0;
+	game->wurmals_killed = 0;
 
-	lives_at_level_start = lives;
+	game->lives_at_level_start = game->lives;
 
-	player->resetTimers();
+	game->player->resetTimers();
 	setGroundColour();
 	initTunnels();
 
 	// Create static objects
-	switch(level)
+	switch(game->level)
 	{
 	case 1:
 	case 2:
@@ -150,58 +174,58 @@ void initLevel()
 
 	case 3:
 		activateObjectsTotal(TYPE_BOULDER,3);
-		invisible_powerup_cnt = 1;
-		turbo_enemy_powerup_cnt = 1;
+		game->invisible_powerup_cnt = 1;
+		game->turbo_enemy_powerup_cnt = 1;
 		break;
 
 	case 4:
 		activateObjectsTotal(TYPE_BOULDER,3);
-		invisible_powerup_cnt = 1;
-		superball_powerup_cnt = 1;
-		turbo_enemy_powerup_cnt = 1;
+		game->invisible_powerup_cnt = 1;
+		game->superball_powerup_cnt = 1;
+		game->turbo_enemy_powerup_cnt = 1;
 		break;
 
 	case 5:
 		activateObjectsTotal(TYPE_BOULDER,3);
-		invisible_powerup_cnt = 1;
-		superball_powerup_cnt = 1;
-		turbo_enemy_powerup_cnt = 1;
+		game->invisible_powerup_cnt = 1;
+		game->superball_powerup_cnt = 1;
+		game->turbo_enemy_powerup_cnt = 1;
 		break;
 
 	case 6:
 		activateObjectsTotal(TYPE_BOULDER,4);
-		invisible_powerup_cnt = 1;
-		superball_powerup_cnt = 1;
-		freeze_powerup_cnt = 1;
-		turbo_enemy_powerup_cnt = 1;
+		game->invisible_powerup_cnt = 1;
+		game->superball_powerup_cnt = 1;
+		game->freeze_powerup_cnt = 1;
+		game->turbo_enemy_powerup_cnt = 1;
 		break;
 
 	case 7:
 		activateObjectsTotal(TYPE_BOULDER,4);
-		invisible_powerup_cnt = 2;
-		superball_powerup_cnt = 1;
-		freeze_powerup_cnt = 1;
-		turbo_enemy_powerup_cnt = 1;
+		game->invisible_powerup_cnt = 2;
+		game->superball_powerup_cnt = 1;
+		game->freeze_powerup_cnt = 1;
+		game->turbo_enemy_powerup_cnt = 1;
 		break;
 
 	case 8:
 		activateObjectsTotal(TYPE_BOULDER,5);
-		invisible_powerup_cnt = 2;
-		superball_powerup_cnt = 2;
-		freeze_powerup_cnt = 1;
-		turbo_enemy_powerup_cnt = 2;
+		game->invisible_powerup_cnt = 2;
+		game->superball_powerup_cnt = 2;
+		game->freeze_powerup_cnt = 1;
+		game->turbo_enemy_powerup_cnt = 2;
 		break;
 
 	default:
 		activateObjectsTotal(TYPE_BOULDER,5);
-		invisible_powerup_cnt = 2;
-		superball_powerup_cnt = 2;
-		freeze_powerup_cnt = 2;
-		turbo_enemy_powerup_cnt = 2;
+		game->invisible_powerup_cnt = 2;
+		game->superball_powerup_cnt = 2;
+		game->freeze_powerup_cnt = 2;
+		game->turbo_enemy_powerup_cnt = 2;
 	}
 
-	activateObjectsTotal(TYPE_NUGGET,10+level*3);
-	sprintf(level_text,"LEVEL %02d\n",level);
+	activateObjectsTotal(TYPE_NUGGET,10+game->level*3);
+	sprintf(game->level_text,"LEVEL %02d\n",game->level);
 }
 
 
@@ -210,8 +234,11 @@ void initLevel()
 /*** Have a guess ***/
 void deactivateAllObjects()
 {
-	for(auto obj: objects) obj->setStage(STAGE_INACTIVE);
-	
+	for(int t=0;t < NUM_TYPES;++t)
+	{
+		while(game->active_list[t].head)
+			game->active_list[t].head->setStage(STAGE_INACTIVE);
+	}
 }
 
 
@@ -222,10 +249,8 @@ void deactivateAllObjects()
 void activateObjectsTotal(en_type type, int num)
 {
 	if (num < 1) return;
-	int cnt = 0;
+	int cnt = game->active_list[type].cnt;
 
-	for(auto obj: objects)
-		cnt += (obj->stage != STAGE_INACTIVE && obj->type == type);
 	if (cnt < num) activateObjects(type,num - cnt);
 }
 
@@ -236,15 +261,16 @@ void activateObjectsTotal(en_type type, int num)
 void activateObjects(en_type type, int num)
 {
 	if (num < 1) return;
+	cl_object *next;
 	int cnt = 0;
 
-	for(auto obj: objects)
+	// activate() can fail and leave the object inactive in which case
+	// move on to the next one
+	for(cl_object *obj=game->free_list[type].head;obj;obj=next)
 	{
-		if (obj->type == type && obj->stage == STAGE_INACTIVE)
-		{
-			obj->activate();
-			if (++cnt == num) return;
-		}
+		next = obj->list_next;
+		obj->activate();
+		if (++cnt == num) return;
 	}
 }
 
@@ -256,9 +282,9 @@ void activateBonusScore(cl_object *obj, int bonus)
 {
 	for(int i=0;i < NUM_BONUS_SCORES;++i)
 	{
-		if (!text_bonus_score[i]->running)
+		if (!game->text_bonus_score[i]->running)
 		{
-			text_bonus_score[i]->reset(obj,bonus);
+			game->text_bonus_score[i]->reset(obj,bonus);
 			break;
 		}
 	}
@@ -275,6 +301,7 @@ void setScaling()
 	x_scaling = (double)win_width / SCR_SIZE;
 	y_scaling = (double)win_height / SCR_SIZE;
 	avg_scaling = (x_scaling + y_scaling) / 2;
+	invalidateBackground();
 }
 
 
@@ -283,27 +310,27 @@ void setScaling()
 /*** Set the score to the specific value ***/
 void setScore(int val)
 {
-	score = val;
-	if (score > high_score && !IN_ATTRACT_MODE()) 
+	game->score = val;
+	if (game->score > game->high_score && !IN_ATTRACT_MODE()) 
 	{
-		high_score = score;
-		if (!done_high_score)
+		game->high_score = game->score;
+		if (!game->done_high_score)
 		{
-			text_new_high_score->reset();
-			done_high_score = true;
+			game->text_new_high_score->reset();
+			game->done_high_score = true;
 			playFGSound(SND_HIGH_SCORE);
 		}
 	}
-	if (score >= bonus_life_score && !IN_ATTRACT_MODE())
+	if (game->score >= game->bonus_life_score && !IN_ATTRACT_MODE())
 	{
-		bonus_life_score += BONUS_LIFE_INC;
-		text_bonus_life->reset();
-		setLives(lives + 1);
-		++lives_at_level_start;
+		game->bonus_life_score += BONUS_LIFE_INC;
+		game->text_bonus_life->reset();
+		setLives(game->lives + 1);
+		++game->lives_at_level_start;
 		playFGSound(SND_BONUS_LIFE);
 	}
-	sprintf(score_text,"%06u",score);
-	sprintf(high_score_text,"%06u",high_score);
+	sprintf(game->score_text,"%06u",game->score);
+	sprintf(game->high_score_text,"%06u",game->high_score);
 }
 
 
@@ -311,7 +338,7 @@ void setScore(int val)
 
 void incScore(int val)
 {
-	setScore(score + val);
+	setScore(game->score + val);
 }
 
 
@@ -319,8 +346,8 @@ void incScore(int val)
 
 void setLives(int val)
 {
-	lives = val;
-	sprintf(lives_text,"%u",lives);
+	game->lives = val;
+	sprintf(game->lives_text,"%u",game->lives);
 }
 
 
@@ -329,27 +356,27 @@ void setLives(int val)
 /*** Set the ground colour based on the level ***/
 void setGroundColour()
 {
-	switch(level % 10)
+	switch(game->level % 10)
 	{
 	case 1:
 	case 2:
-		ground_colour = COL_KHAKI;
+		game->ground_colour = COL_KHAKI;
 		break;
 	case 3:
 	case 4:
-		ground_colour = COL_DARK_GREEN;
+		game->ground_colour = COL_DARK_GREEN;
 		break;
 	case 5:
 	case 6:
-		ground_colour = COL_STEEL_BLUE;
+		game->ground_colour = COL_STEEL_BLUE;
 		break;
 	case 7:
 	case 8:
-		ground_colour = COL_DARK_MAUVE;
+		game->ground_colour = COL_DARK_MAUVE;
 		break;
 	case 9:
 	case 0:
-		ground_colour = COL_DARK_RED;
+		game->ground_colour = COL_DARK_RED;
 	}
 }
 
@@ -426,5 +453,5 @@ double angleDiff(double ang1, double ang2)
 /*** Return true if location is out of the game area ***/
 bool offscreen(int x, int y)
 {
-	return (x < 0 || x >= SCR_SIZE || y < PLAY_AREA_TOP || y >= SCR_SIZE);
+	return !ONSCREEN(x,y);
 }
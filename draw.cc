@@ -2,6 +2,73 @@
 
 #include "globals.h"
 
+#define MAX_SEG_BUCKETS 20
+#define MAX_BUCKET_SEGS 500
+#define GLYPH_CACHE_SIZE 512  // Must be a power of 2
+#define MAX_GLYPH_SEGS   18   // The '@' has the most
+
+/* Lines are batched up by colour and width and sent with a single 
+   XDrawSegments() per batch. A single line of text can be dozens of lines
+   so this saves a lot of X requests */
+static struct st_seg_bucket
+{
+	int col;
+	int width;
+	int cnt;
+	XSegment seg[MAX_BUCKET_SEGS];
+} seg_bucket[MAX_SEG_BUCKETS];
+
+static int num_seg_buckets;
+
+/* What the line attributes of each GC are currently set to on the server so
+   we only send XSetLineAttributes() when something actually changes */
+static struct st_line_attr
+{
+	bool set;
+	int width;
+	int cap;
+	int join;
+} line_attr[NUM_COLOURS];
+
+// Line attribute request counts for the current frame and all frames
+static int frame_attr_sent;
+static int frame_attr_saved;
+static int max_attr_saved;
+static u_long total_attr_sent;
+static u_long total_attr_saved;
+static u_long frames_drawn;
+
+/* Characters already rotated, scaled and converted to window pixels. Most 
+   text is drawn at angle 0 and only a few scales so nearly everything is a
+   hit. Animated text that changes every frame just overwrites its slot. */
+static struct st_glyph
+{
+	u_char c;
+	double ang;
+	double x_scale;
+	double y_scale;
+	double win_x_scaling;
+	double win_y_scaling;
+	int cnt;
+	XSegment seg[MAX_GLYPH_SEGS];
+} glyph_cache[GLYPH_CACHE_SIZE];
+
+/* The ground, molehills, stones and tunnels only change when the player
+   digs so they're kept in a pixmap on the server and copied into the window
+   each frame. Digging just fills in the dug area of the pixmap. */
+static Pixmap bg_pixmap;
+static int bg_width;
+static int bg_height;
+static int bg_colour;
+static thread_local bool bg_valid;
+
+static void buildBackground();
+static st_glyph *getGlyph(
+	u_char c, double ang, double x_scale, double y_scale);
+static void setLineAttributes(int col, int width);
+static st_seg_bucket *getSegBucket(int col, double thick, int need);
+static void flushBucket(st_seg_bucket *bucket);
+
 ///////////////////////////// HIGH LEVEL DRAWING /////////////////////////////
 
 /*** Draw ascii table. For debugging ***/
@@ -40,101 +107,87 @@ void drawAsciiTable()
 /*** Draw the actual game screen ***/
 void drawGameScreen()
 {
-	vector<cl_tunnel *>::iterator it1;
 	char text[20];
 
+	drawBackground();
+
 	drawText("SCORE:",COL_TURQUOISE,2,0,0,0.75,1,10,10);
-	drawText(score_text,COL_GREEN,2,0,0,1,1,85,10);
+	drawText(game->score_text,COL_GREEN,2,0,0,1,1,85,10);
 
 	drawText("HIGH :",COL_TURQUOISE,2,0,0,0.75,1,10,25);
-	if (!done_high_score || (game_stage_cnt % 30) < 15)
-		drawText(high_score_text,COL_PURPLE,2,0,0,1,1,85,25);
+	if (!game->done_high_score || (game->game_stage_cnt % 30) < 15)
+		drawText(game->high_score_text,COL_PURPLE,2,0,0,1,1,85,25);
 
 	drawText("LIVES:",COL_TURQUOISE,2,0,0,0.75,1.5,SCR_SIZE - 85,15);
-	drawText(lives_text,COL_RED,2,0,0,1,1.5,SCR_SIZE - 10,15);
+	drawText(game->lives_text,COL_RED,2,0,0,1,1.5,SCR_SIZE - 10,15);
 
 	// Draw player powerup countdowns
-	if (player->invisible_timer) 
+	if (game->player->invisible_timer) 
 	{
-		sprintf(text,"%03d",player->invisible_timer);
+		sprintf(text,"%03d",game->player->invisible_timer);
 		drawText(text,COL_YELLOW,2,0,0,1,1.5,SCR_MID-15,15);
 	}
-	else if (player->freeze_timer)
+	else if (game->player->freeze_timer)
 	{
-		sprintf(text,"%03d",player->freeze_timer);
+		sprintf(text,"%03d",game->player->freeze_timer);
 		drawText(text,COL_TURQUOISE,2,0,0,1,1.5,SCR_MID-15,15);
 	}
 
-	// Draw ground, molehills and lines at top so theres always a roof on 
-	// top tunnels
-	drawOrFillRectangle(
-		ground_colour,0,0,PLAY_AREA_TOP,SCR_SIZE,PLAY_AREA_HEIGHT,FILL);
-	for(auto mh: molehill) mh.draw();
-
-	drawLine(
-		ground_colour,4,
-		0,PLAY_AREA_TOP-2,START_X-TUNNEL_HALF-2,PLAY_AREA_TOP-2);
-	drawLine(
-		ground_colour,4,
-		START_X+TUNNEL_HALF+2,PLAY_AREA_TOP-2,SCR_SIZE,PLAY_AREA_TOP-2);
-
-	// Draw stones
-	for(auto stn: stones) stn->draw();
-
-	// Draw tunnels
-	for(auto tun: tunnels) tun->draw();
-
 	// Draw game objects
-	for(auto obj: objects) if (obj->stage != STAGE_INACTIVE) obj->draw();
+	drawObjects();
 		
-	switch(game_stage)
+	switch(game->game_stage)
 	{
 	case GAME_STAGE_ATTRACT_PLAY:
-		text_digger->draw();
-		text_s_to_start->draw();
-		text_copyright->draw();
+		game->text_digger->draw();
+		game->text_s_to_start->draw();
+		game->text_copyright->draw();
 		drawText(version_text,COL_WHITE,1,0,0,0.8,1.2,170,SCR_SIZE - 10);
 		break;
 
 	case GAME_STAGE_LEVEL_START:
-		text_level_start->draw();
+		game->text_level_start->draw();
 		break;
 
 	case GAME_STAGE_READY:
-		text_ready->draw();
+		game->text_ready->draw();
 		break;
 
 	case GAME_STAGE_PLAY:
-		if (paused) text_paused->draw();
+		if (game->paused) game->text_paused->draw();
 		else
 		{
-			text_new_high_score->draw();
-			text_bonus_life->draw();
+			game->text_new_high_score->draw();
+			game->text_bonus_life->draw();
 		}
 		break;
 
 	case GAME_STAGE_LEVEL_COMPLETE:
-		if (game_stage_cnt % 40 < 20)
+		if (game->game_stage_cnt % 40 < 20)
 			drawText("LEVEL COMPLETE",COL_LIGHT_BLUE,8,0,0,2.8,7,52,SCR_MID - 30);
-		if (end_of_level_bonus)
-			drawText(end_of_level_bonus_str,COL_WHITE,6,0,0,2,6,175,SCR_MID + 60);
+		if (game->end_of_level_bonus)
+		{
+			drawText(
+				game->end_of_level_bonus_str,
+				COL_WHITE,6,0,0,2,6,175,SCR_MID + 60);
+		}
 		break;
 
 	case GAME_STAGE_GAME_OVER:
-		text_game_over->draw();
+		game->text_game_over->draw();
 		break;
 
 	default:
 		break;
 	}	
 
-	for(auto tbs: text_bonus_score) if (tbs->running) tbs->draw();
+	for(auto tbs: game->text_bonus_score) if (tbs->running) tbs->draw();
 
-	if (text_got_spiky->running) text_got_spiky->draw();
+	if (game->text_got_spiky->running) game->text_got_spiky->draw();
 
-	text_invisibility_powerup->draw();
-	text_superball_powerup->draw();
-	text_freeze_powerup->draw();
+	game->text_invisibility_powerup->draw();
+	game->text_superball_powerup->draw();
+	game->text_freeze_powerup->draw();
 
 #ifdef SOUND
 	if (!do_sound && !IN_ATTRACT_MODE())
@@ -168,15 +221,15 @@ void drawEnemyScreen()
 
 	drawText(
 		"*** THE ENEMIES ***",
-		random() % NUM_FULL_COLOURS,2,0,0,1.5,2,SCR_MID - 200,30);
+		getRandom(RAND_GFX) % NUM_FULL_COLOURS,2,0,0,1.5,2,SCR_MID - 200,30);
 
 	for(int i=0;i < NUM_ATTRACT_ENEMIES;++i)
 	{
-		attract_enemy[i]->draw();
+		game->attract_enemy[i]->draw();
 
 		drawText(
 			name[i],colour[i],4,0,0,1,2,
-			attract_enemy[i]->x + 100,attract_enemy[i]->y);
+			game->attract_enemy[i]->x + 100,game->attract_enemy[i]->y);
 	}
 }
 
@@ -211,6 +264,133 @@ void drawKeysScreen()
 }
 
 
+/////////////////////////////// BACKGROUND /////////////////////////////////
+
+/*** Copy the background into the window. It gets rebuilt if its been 
+     thrown away or the ground colour has changed. Must be drawn first as it
+     covers the whole window. ***/
+void drawBackground()
+{
+	if (!do_draw) return;
+
+	if (!bg_valid || bg_colour != game->ground_colour) buildBackground();
+
+	flushLines();
+	if (use_shm)
+	{
+		fbCopyBackground();
+		return;
+	}
+	XCopyArea(
+		display,
+		bg_pixmap,drw,gc[COL_BLACK],0,0,bg_width,bg_height,0,0);
+}
+
+
+
+
+/*** Draw ground, molehills, lines at top so theres always a roof on top 
+     tunnels, stones then tunnels into the pixmap ***/
+void buildBackground()
+{
+	Drawable save_drw = drw;
+
+	flushLines();
+
+	// Shared memory drawing keeps its own copy of the background
+	if (use_shm)
+	{
+		fbTarget(true);
+		rasterFillRectangle(COL_BLACK,0,0,win_width,win_height);
+	}
+	else
+	{
+		if (!bg_pixmap || 
+		    bg_width != win_width || bg_height != win_height)
+		{
+			if (bg_pixmap) XFreePixmap(display,bg_pixmap);
+			bg_width = win_width;
+			bg_height = win_height;
+			bg_pixmap = XCreatePixmap(
+				display,win,bg_width,bg_height,
+				DefaultDepth(display,DefaultScreen(display)));
+		}
+		drw = bg_pixmap;
+		XFillRectangle(
+			display,drw,gc[COL_BLACK],0,0,bg_width,bg_height);
+	}
+
+	drawOrFillRectangle(
+		game->ground_colour,0,0,PLAY_AREA_TOP,SCR_SIZE,PLAY_AREA_HEIGHT,FILL);
+	for(auto mh: game->molehill) mh.draw();
+
+	drawLine(
+		game->ground_colour,4,
+		0,PLAY_AREA_TOP-2,START_X-TUNNEL_HALF-2,PLAY_AREA_TOP-2);
+	drawLine(
+		game->ground_colour,4,
+		START_X+TUNNEL_HALF+2,PLAY_AREA_TOP-2,SCR_SIZE,PLAY_AREA_TOP-2);
+
+	for(auto stn: game->stones) stn->draw();
+	for(auto tun: game->tunnels) tun->draw();
+
+	flushLines();
+	if (use_shm)
+		fbTarget(false);
+	else
+		drw = save_drw;
+
+	bg_colour = game->ground_colour;
+	bg_valid = true;
+}
+
+
+
+
+/*** Called from fillTunnelArea(). Clears the dug area in the background. 
+     This is done whether or not the frame is being drawn. ***/
+void digBackground(int x1, int y1, int x2, int y2)
+{
+	double x;
+	double y;
+	double w;
+	double h;
+
+	if (!bg_valid) return;
+
+	x = x1 * x_scaling;
+	y = y1 * y_scaling;
+	w = (x2 - x1 + 1) * x_scaling;
+	h = (y2 - y1 + 1) * y_scaling;
+
+	if (w < 1) w = 1;
+	if (h < 1) h = 1;
+
+	if (use_shm)
+	{
+		fbTarget(true);
+		rasterFillRectangle(COL_BLACK,(int)x,(int)y,(int)w,(int)h);
+		fbTarget(false);
+	}
+	else
+	{
+		XFillRectangle(
+			display,
+			bg_pixmap,gc[COL_BLACK],(int)x,(int)y,(int)w,(int)h);
+	}
+}
+
+
+
+
+/*** Have the background rebuilt next time its drawn. Called on a new level
+     and if the window is resized. ***/
+void invalidateBackground()
+{
+	bg_valid = false;
+}
+
+
 ///////////////////////////////// TEXT DRAWING ////////////////////////////////
 
 /*** Draw some text ***/
@@ -222,8 +402,11 @@ void drawText(
 	double gap,
 	double x_scale, double y_scale, double x, double y)
 {
-	int len = strlen(mesg);
+	int len;
+
+	if (!do_draw) return;
 
+	len = strlen(mesg);
 	if (!gap) gap = CHAR_GAP;
 
 	for(int i=0;i < len;++i)
@@ -237,49 +420,143 @@ void drawText(
 
 
 
-/*** Draw a character ***/
+/*** Draw a character. The glyph is offset to the character centre and 
+     added straight into the line batch ***/
 void drawChar(
 	char c,
 	int col,
 	int thick,
 	double ang, double x_scale, double y_scale, double x, double y)
 {
-	st_char_template *tmpl;
-	double x1;
-	double y1;
-	double x2;
-	double y2;
+	st_seg_bucket *bucket;
+	st_glyph *glyph;
+	XSegment *seg;
+	short xp;
+	short yp;
+
+	if (!do_draw || !ascii_table[(u_char)c]) return;
+
+	glyph = getGlyph((u_char)c,ang,x_scale,y_scale);
+	if (!glyph->cnt) return;
 
-	if (!(tmpl = ascii_table[(int)c])) return;
+	if (col < COL_GREEN || col >= NUM_COLOURS) col = COL_GREEN;
+	bucket = getSegBucket(col,thick,glyph->cnt);
+
+	xp = (short)(x * x_scaling);
+	yp = (short)(y * y_scaling);
+	seg = &bucket->seg[bucket->cnt];
 
-	// Draw character
-	for(int i=0;i < tmpl->cnt;i+=2)
+	for(int i=0;i < glyph->cnt;++i,++seg)
 	{
+		seg->x1 = xp + glyph->seg[i].x1;
+		seg->y1 = yp + glyph->seg[i].y1;
+		seg->x2 = xp + glyph->seg[i].x2;
+		seg->y2 = yp + glyph->seg[i].y2;
+	}
+	bucket->cnt += glyph->cnt;
+}
+
 
-		x1 = x + ((double)tmpl->data[i].x * x_scale * COS(ang)) -
-		         ((double)tmpl->data[i].y * y_scale * SIN(ang));
-		y1 = y + ((double)tmpl->data[i].y * y_scale * COS(ang)) + 
-		         ((double)tmpl->data[i].x * x_scale * SIN(ang));
-		x2 = x + ((double)tmpl->data[i+1].x * x_scale * COS(ang)) -
-		         ((double)tmpl->data[i+1].y * y_scale * SIN(ang));
-		y2 = y + ((double)tmpl->data[i+1].y * y_scale * COS(ang)) + 
-		         ((double)tmpl->data[i+1].x * x_scale * SIN(ang));
 
-		drawLine(col,thick,x1,y1,x2,y2);
+
+/*** Find the character in the cache. If its not there create it from the
+     ascii table template ***/
+st_glyph *getGlyph(u_char c, double ang, double x_scale, double y_scale)
+{
+	st_char_template *tmpl = ascii_table[c];
+	st_glyph *glyph;
+	XPoint *pnt;
+	double cos_ang;
+	double sin_ang;
+	u_int hash;
+	int i;
+
+	hash = c * 31 + 
+	       (u_int)(ang * 7) + 
+	       (u_int)(x_scale * 113) * 17 + 
+	       (u_int)(y_scale * 127) * 5;
+	glyph = &glyph_cache[hash & (GLYPH_CACHE_SIZE - 1)];
+
+	if (glyph->c == c && 
+	    glyph->ang == ang &&
+	    glyph->x_scale == x_scale && 
+	    glyph->y_scale == y_scale &&
+	    glyph->win_x_scaling == x_scaling &&
+	    glyph->win_y_scaling == y_scaling) return glyph;
+
+	assert(tmpl->cnt / 2 <= MAX_GLYPH_SEGS);
+
+	glyph->c = c;
+	glyph->ang = ang;
+	glyph->x_scale = x_scale;
+	glyph->y_scale = y_scale;
+	glyph->win_x_scaling = x_scaling;
+	glyph->win_y_scaling = y_scaling;
+	glyph->cnt = tmpl->cnt / 2;
+
+	cos_ang = COS(ang);
+	sin_ang = SIN(ang);
+
+	for(i=0,pnt=tmpl->data;i < glyph->cnt;++i,pnt+=2)
+	{
+		glyph->seg[i].x1 = (short)rint(
+			(pnt[0].x * x_scale * cos_ang - 
+			 pnt[0].y * y_scale * sin_ang) * x_scaling);
+		glyph->seg[i].y1 = (short)rint(
+			(pnt[0].y * y_scale * cos_ang +
+			 pnt[0].x * x_scale * sin_ang) * y_scaling);
+		glyph->seg[i].x2 = (short)rint(
+			(pnt[1].x * x_scale * cos_ang - 
+			 pnt[1].y * y_scale * sin_ang) * x_scaling);
+		glyph->seg[i].y2 = (short)rint(
+			(pnt[1].y * y_scale * cos_ang +
+			 pnt[1].x * x_scale * sin_ang) * y_scaling);
 	}
+	return glyph;
 }
 
 
 
 ///////////////////////////// LOW LEVEL DRAWING ///////////////////////////////
 
+/*** Get the line width in pixels allowing for window scaling ***/
+int lineWidth(double thick)
+{
+	thick *= avg_scaling;
+	return thick < 1 ? 1 : (int)rint(thick);
+}
+
+
+
+
 /*** Set the thickness of the graphics context for the given colour ***/
 void setThickness(int col, double thick)
 {
-	thick *= avg_scaling;
-	if (thick < 1) thick = 1;
-	XSetLineAttributes(
-		display,gc[col],(int)rint(thick),LineSolid,CapRound,JoinRound);
+	setLineAttributes(col,lineWidth(thick));
+}
+
+
+
+
+/*** Only send the request if the GC doesn't already have these settings ***/
+void setLineAttributes(int col, int width)
+{
+	st_line_attr *attr = &line_attr[col];
+
+	if (attr->set && 
+	    attr->width == width && 
+	    attr->cap == CapRound && attr->join == JoinRound)
+	{
+		++frame_attr_saved;
+		return;
+	}
+	XSetLineAttributes(display,gc[col],width,LineSolid,CapRound,JoinRound);
+
+	attr->set = true;
+	attr->width = width;
+	attr->cap = CapRound;
+	attr->join = JoinRound;
+	++frame_attr_sent;
 }
 
 
@@ -287,10 +564,14 @@ void setThickness(int col, double thick)
 
 /*** Draw a line taking into acount the scaling factors. Can't check onscreen
      because start and end points may be offscreen by line crosses screen.
-     Same applies to rectangles and polygons ***/
+     Same applies to rectangles and polygons. The line isn't sent to X here, 
+     it goes into the batch for its colour and width. ***/
 void drawLine(int col, double thick, double x1, double y1, double x2, double y2)
 {
-	if (refresh_cnt) return;
+	st_seg_bucket *bucket;
+	XSegment *seg;
+
+	if (!do_draw) return;
 
 	x1 *= x_scaling;
 	y1 *= y_scaling;
@@ -298,8 +579,113 @@ void drawLine(int col, double thick, double x1, double y1, double x2, double y2)
 	y2 *= y_scaling;
 	if (col < COL_GREEN || col >= NUM_COLOURS) col = COL_GREEN;
 
-	setThickness(col,thick);
-	XDrawLine(display,drw,gc[col],(int)x1,(int)y1,(int)x2,(int)y2);
+	bucket = getSegBucket(col,thick,1);
+	seg = &bucket->seg[bucket->cnt++];
+	seg->x1 = (short)x1;
+	seg->y1 = (short)y1;
+	seg->x2 = (short)x2;
+	seg->y2 = (short)y2;
+}
+
+
+
+
+/*** Find the batch for the colour and width or start a new one. Makes sure
+     theres room for the number of segments needed. ***/
+st_seg_bucket *getSegBucket(int col, double thick, int need)
+{
+	st_seg_bucket *bucket;
+	int width = lineWidth(thick);
+	int i;
+
+	for(i=0;i < num_seg_buckets;++i)
+	{
+		bucket = &seg_bucket[i];
+		if (bucket->col == col && bucket->width == width)
+		{
+			if (bucket->cnt + need > MAX_BUCKET_SEGS)
+				flushBucket(bucket);
+			return bucket;
+		}
+	}
+
+	if (num_seg_buckets == MAX_SEG_BUCKETS) flushLines();
+
+	bucket = &seg_bucket[num_seg_buckets++];
+	bucket->col = col;
+	bucket->width = width;
+	bucket->cnt = 0;
+	return bucket;
+}
+
+
+
+
+/*** Send all the batched lines. Has to be called before anything else is
+     drawn so lines don't end up on top of shapes that should cover them and
+     before the buffers are swapped. ***/
+void flushLines()
+{
+	for(int i=0;i < num_seg_buckets;++i) flushBucket(&seg_bucket[i]);
+	num_seg_buckets = 0;
+}
+
+
+
+
+/*** Called when everything in the frame has been drawn ***/
+void endFrame()
+{
+	if (!do_draw) return;
+
+	flushLines();
+
+	total_attr_sent += frame_attr_sent;
+	total_attr_saved += frame_attr_saved;
+	if (frame_attr_saved > max_attr_saved) max_attr_saved = frame_attr_saved;
+	frame_attr_sent = 0;
+	frame_attr_saved = 0;
+	++frames_drawn;
+}
+
+
+
+
+/*** Print how many XSetLineAttributes() calls the cache saved ***/
+void drawReport()
+{
+	u_long total = total_attr_sent + total_attr_saved;
+
+	if (!frames_drawn || !total) return;
+
+	printf("Line attributes: %.1f sent/frame, %.1f saved/frame (max %d), "
+	       "%.1f%% saved\n",
+		(double)total_attr_sent / frames_drawn,
+		(double)total_attr_saved / frames_drawn,
+		max_attr_saved,
+		100.0 * total_attr_saved / total);
+}
+
+
+
+
+/*** Draw all the lines in the batch and empty it ***/
+void flushBucket(st_seg_bucket *bucket)
+{
+	if (!bucket->cnt) return;
+
+	if (use_shm)
+	{
+		rasterSegments(
+			bucket->col,bucket->width,bucket->seg,bucket->cnt);
+	}
+	else
+	{
+		setLineAttributes(bucket->col,bucket->width);
+		XDrawSegments(
+			display,drw,gc[bucket->col],bucket->seg,bucket->cnt);
+	}
+	bucket->cnt = 0;
 }
 
 
@@ -316,7 +702,8 @@ void drawOrFillCircle(
 	double xp;
 	double yp;
 
-	if (refresh_cnt) return;
+	if (!do_draw) return;
+	flushLines();
 
 	if (col < COL_GREEN || col >= NUM_COLOURS) col = COL_GREEN;
 
@@ -336,7 +723,13 @@ void drawOrFillCircle(
 	if (xp >= -diam && xp <= (double)win_width && 
 	    yp >= -diam && yp <= (double)win_height)
 	{
-		if (fill == FILL)
+		if (use_shm)
+		{
+			rasterDrawOrFillEllipse(
+				col,fill == FILL ? 0 : lineWidth(thick),
+				(int)xp,(int)yp,(int)x_diam,(int)y_diam);
+		}
+		else if (fill == FILL)
 		{
 			XFillArc(
 				display,drw,gc[col],
@@ -364,7 +757,8 @@ void drawOrFillPolygon(
 {
 	int i;
 
-	if (refresh_cnt) return;
+	if (!do_draw) return;
+	flushLines();
 
 	if (col < COL_GREEN || col >= NUM_COLOURS) col = COL_GREEN;
 
@@ -373,7 +767,12 @@ void drawOrFillPolygon(
 		points[i].x = (int)((double)points[i].x * x_scaling);
 		points[i].y = (int)((double)points[i].y * y_scaling);
 	}
-	if (fill == FILL)
+	if (use_shm)
+	{
+		if (fill == FILL) rasterFillPolygon(col,points,num_points);
+		else rasterDrawPolygon(col,lineWidth(thick),points,num_points);
+	}
+	else if (fill == FILL)
 	{
 		XFillPolygon(
 			display,drw,gc[col],
@@ -402,7 +801,8 @@ void drawOrFillRectangle(
 	int col,
 	double thick, double x, double y, double w, double h, bool fill)
 {
-	if (refresh_cnt) return;
+	if (!do_draw) return;
+	flushLines();
 
 	x *= x_scaling;
 	y *= y_scaling;
@@ -414,7 +814,17 @@ void drawOrFillRectangle(
 
 	if (col < COL_GREEN || col >= NUM_COLOURS) col = COL_GREEN;
 
-	if (fill == FILL)
+	if (use_shm)
+	{
+		if (fill == FILL)
+			rasterFillRectangle(col,(int)x,(int)y,(int)w,(int)h);
+		else
+		{
+			rasterDrawRectangle(
+				col,lineWidth(thick),(int)x,(int)y,(int)w,(int)h);
+		}
+	}
+	else if (fill == FILL)
 		XFillRectangle(display,drw,gc[col],(int)x,(int)y,(int)w,(int)h);
 	else
 	{
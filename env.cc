@@ -0,0 +1,287 @@
+// Batched game environment for training bots. See env.h for the interface.
+//
+// The games are shared out between a fixed number of workers which each step
+// theirs one after the other, switching with setGame(). Worker 0 is the
+// caller's own thread. The rest are threads that sit waiting for the next
+// step. envStep() hands the actions over, wakes them, does its own share and
+// then waits until the last one has filled in its part of the observations.
+
+#include "globals.h"
+#include "env.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+static_assert(ENV_GROUND_COLS == GROUND_COLS,"Env ground size error");
+static_assert(ENV_GROUND_ROWS == GROUND_ROWS,"Env ground size error");
+static_assert(ENV_MAX_OBJECTS == MAX_OBJECTS,"Env max objects error");
+static_assert((int)ENV_TYPE_WURMAL == (int)TYPE_WURMAL,"Env type error");
+static_assert((int)ENV_DOWN == (int)DIR_DOWN,"Env direction error");
+
+struct st_env
+{
+	int num_games;
+	int num_workers;
+	vector<st_game *> games;
+	vector<thread> threads;
+
+	mutex lock;
+	condition_variable start_cond;
+	condition_variable done_cond;
+
+	// Bumped to start a step. Worker threads count themselves done.
+	u_long step;
+	int num_done;
+	bool quit;
+
+	// What the current step is to do. actions is NULL if it's only
+	// to observe.
+	const uint8_t *actions;
+	st_env_obs obs;
+};
+
+static KeySym dir_key[] = { 0, XK_Left, XK_Right, XK_Up, XK_Down };
+
+static void envRun(st_env *env, const st_env_obs *obs);
+static void envWorker(st_env *env, int worker);
+static void envStepGames(st_env *env, int worker);
+static void envStepGame(st_env *env, int num);
+static void envAction(uint8_t action);
+static void envFillObs(
+	st_env *env, int num, int score_delta, int lives_delta, bool over);
+
+
+/*** Create the games with seeds seed to seed + num_games - 1 and start them
+     on level 1. They're stepped by num_workers threads including the
+     caller's. ***/
+st_env *envCreate(int num_games, int num_workers, uint64_t seed)
+{
+	static once_flag init_flag;
+	st_game *prev_game = game;
+	st_env *env;
+	int i;
+
+	assert(num_games > 0 && num_workers > 0);
+
+	// Process wide setup that the game front end would normally do. It
+	// adjusts the glyph data in place so must only ever run once even if
+	// environments are created from several threads.
+	call_once(init_flag,init);
+
+	env = new st_env;
+	env->num_games = num_games;
+	env->num_workers = min(num_workers,num_games);
+	env->step = 0;
+	env->num_done = 0;
+	env->quit = false;
+	env->actions = NULL;
+
+	for(i=0;i < num_games;++i)
+	{
+		env->games.push_back(newGame(seed + i));
+		startGame();
+	}
+	setGame(prev_game);
+
+	for(i=1;i < env->num_workers;++i)
+		env->threads.push_back(thread(envWorker,env,i));
+	return env;
+}
+
+
+
+
+/*** Run one tick of every game with an action each then fill in the
+     observations ***/
+void envStep(st_env *env, const uint8_t *actions, const st_env_obs *obs)
+{
+	env->actions = actions;
+	envRun(env,obs);
+}
+
+
+
+
+/*** Fill in the observations without running a tick. Deltas will be 0. ***/
+void envObserve(st_env *env, const st_env_obs *obs)
+{
+	env->actions = NULL;
+	envRun(env,obs);
+}
+
+
+
+
+/*** Stop the threads and free the games ***/
+void envDestroy(st_env *env)
+{
+	{
+		lock_guard<mutex> lk(env->lock);
+		env->quit = true;
+	}
+	env->start_cond.notify_all();
+	for(auto &thr: env->threads) thr.join();
+	for(auto g: env->games) freeGame(g);
+	delete env;
+}
+
+
+/////////////////////////////////// WORKERS ///////////////////////////////////
+
+/*** Wake the worker threads, do our own share then wait for them all to
+     finish ***/
+void envRun(st_env *env, const st_env_obs *obs)
+{
+	st_game *prev_game = game;
+	bool prev_do_draw = do_draw;
+
+	{
+		lock_guard<mutex> lk(env->lock);
+		env->obs = *obs;
+		env->num_done = 0;
+		++env->step;
+	}
+	env->start_cond.notify_all();
+
+	do_draw = false;
+	envStepGames(env,0);
+	setGame(prev_game);
+	do_draw = prev_do_draw;
+
+	unique_lock<mutex> lk(env->lock);
+	while(env->num_done < env->num_workers - 1) env->done_cond.wait(lk);
+}
+
+
+
+
+/*** Thread body for workers 1 upwards ***/
+void envWorker(st_env *env, int worker)
+{
+	u_long step = 0;
+
+	do_draw = false;
+
+	for(;;)
+	{
+		{
+			unique_lock<mutex> lk(env->lock);
+			while(env->step == step && !env->quit)
+				env->start_cond.wait(lk);
+			if (env->quit) return;
+			step = env->step;
+		}
+
+		envStepGames(env,worker);
+
+		lock_guard<mutex> lk(env->lock);
+		if (++env->num_done == env->num_workers - 1)
+			env->done_cond.notify_one();
+	}
+}
+
+
+
+
+/*** Each worker has a contiguous block of games ***/
+void envStepGames(st_env *env, int worker)
+{
+	int from = env->num_games * worker / env->num_workers;
+	int to = env->num_games * (worker + 1) / env->num_workers;
+
+	for(int num=from;num < to;++num)
+	{
+		setGame(env->games[num]);
+		envStepGame(env,num);
+	}
+}
+
+
+
+
+void envStepGame(st_env *env, int num)
+{
+	int score_delta;
+	int lives_delta;
+	int prev_score;
+	int prev_lives;
+	bool over;
+
+	if (!env->actions)
+	{
+		envFillObs(env,num,0,0,false);
+		return;
+	}
+
+	prev_score = game->score;
+	prev_lives = game->lives;
+
+	envAction(env->actions[num]);
+	gameTick();
+
+	score_delta = game->score - prev_score;
+	lives_delta = game->lives - prev_lives;
+
+	// Don't hang about on the game over screen, go straight into
+	// another game
+	over = (game->game_stage == GAME_STAGE_GAME_OVER);
+	if (over) startGame();
+
+	envFillObs(env,num,score_delta,lives_delta,over);
+}
+
+
+
+
+/*** Do what a player at the keyboard would. Keys are ignored outside of
+     play in the same way as keyPress() does. ***/
+void envAction(uint8_t action)
+{
+	int dir = action & ENV_DIR_MASK;
+
+	if (game->game_stage != GAME_STAGE_PLAY || dir > ENV_DOWN) return;
+
+	if (dir == ENV_STOP)
+	{
+		if (game->player->dir != DIR_STOP)
+			game->player->stop(dir_key[game->player->dir]);
+	}
+	else if (game->player->dir != dir) game->player->move(dir_key[dir]);
+
+	if (action & ENV_THROW) game->player->throwBall();
+}
+
+
+
+
+/*** Write this game's part of the observations ***/
+void envFillObs(
+	st_env *env, int num, int score_delta, int lives_delta, bool over)
+{
+	st_env_obs *obs = &env->obs;
+	st_env_object *eobj;
+	cl_object *obj;
+	int cnt;
+
+	if (obs->ground) groundCopy(obs->ground + num * ENV_GROUND_CELLS);
+
+	if (obs->objects || obs->num_objects)
+	{
+		cnt = 0;
+		for(obj=firstActiveObject();obj;obj=nextActiveObject(obj),++cnt)
+		{
+			if (!obs->objects) continue;
+			eobj = &obs->objects[num * ENV_MAX_OBJECTS + cnt];
+			eobj->x = (float)obj->x;
+			eobj->y = (float)obj->y;
+			eobj->type = obj->type;
+			eobj->stage = obj->stage;
+		}
+		if (obs->num_objects) obs->num_objects[num] = cnt;
+	}
+
+	if (obs->score_delta) obs->score_delta[num] = score_delta;
+	if (obs->lives_delta) obs->lives_delta[num] = lives_delta;
+	if (obs->done) obs->done[num] = over;
+}
@@ -0,0 +1,98 @@
+/*****************************************************************************
+ DIGGER ENVIRONMENT
+
+ Steps a batch of headless games in lockstep for training bots. Each game has
+ its own seed. The games are shared out between a number of worker threads,
+ the caller's being one of them, so there can be many more games than cores.
+ Actions go in and observations come out through arrays the caller owns with
+ one entry (or block of entries) per game so nothing gets allocated once the
+ environment is created.
+
+ Plain C so it can be used from C or loaded with the likes of Python ctypes.
+ Link with libdiggenv.a -lX11 -lXext -lm -lpthread.
+ *****************************************************************************/
+
+#ifndef DIGG_ENV_H
+#define DIGG_ENV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Ground observation. The play area in 5 pixel cells a row at a time. Each is
+   0 if there's any tunnel in the cell, otherwise how many cells away the
+   nearest tunnel or edge of the play area is. */
+#define ENV_GROUND_COLS  130
+#define ENV_GROUND_ROWS  120
+#define ENV_GROUND_CELLS (ENV_GROUND_COLS * ENV_GROUND_ROWS)
+
+// Most objects a game can have active at once
+#define ENV_MAX_OBJECTS 66
+
+/* Actions. One direction optionally or'd with ENV_THROW. The direction is
+   held until a different one is given, same as keeping a key down. */
+enum en_env_action
+{
+	ENV_STOP,
+	ENV_LEFT,
+	ENV_RIGHT,
+	ENV_UP,
+	ENV_DOWN,
+
+	ENV_DIR_MASK = 7,
+	ENV_THROW    = 8
+};
+
+// Object types
+enum en_env_type
+{
+	ENV_TYPE_PLAYER,
+	ENV_TYPE_BALL,
+	ENV_TYPE_STONE,
+	ENV_TYPE_NUGGET,
+	ENV_TYPE_BOULDER,
+	ENV_TYPE_SMALL_BOULDER,
+	ENV_TYPE_SPOOKY,
+	ENV_TYPE_SPIKY,
+	ENV_TYPE_GRUBBLE,
+	ENV_TYPE_WURMAL
+};
+
+typedef struct st_env_object
+{
+	float x;
+	float y;
+	int16_t type;
+	int16_t stage;  // en_object_stage in globals.h
+} st_env_object;
+
+/* Where envStep() puts its results. Each is an array with an entry per game
+   except ground and objects which have ENV_GROUND_CELLS and ENV_MAX_OBJECTS
+   entries per game. Any of them can be NULL if not wanted. */
+typedef struct st_env_obs
+{
+	uint8_t *ground;
+	st_env_object *objects;
+	int *num_objects;
+	int *score_delta;
+	int *lives_delta;
+
+	// Set when the game ended on this step. A new one is started straight
+	// away so the observations are already for that.
+	uint8_t *done;
+} st_env_obs;
+
+typedef struct st_env st_env;
+
+st_env *envCreate(int num_games, int num_workers, uint64_t seed);
+void envStep(st_env *env, const uint8_t *actions, const st_env_obs *obs);
+void envObserve(st_env *env, const st_env_obs *obs);
+void envDestroy(st_env *env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
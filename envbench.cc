@@ -0,0 +1,168 @@
+// Benchmark for the batched environment in env.cc. Steps a number of games
+// with a simple scripted bot and prints the steps per second along with how
+// the games got on. Only uses env.h so also shows how to drive it.
+// Build with "make envbench".
+
+#include "env.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int num_games;
+static int num_workers;
+static int num_steps;
+static uint64_t seed;
+
+// Observation buffers, allocated once up front
+static uint8_t *actions;
+static uint8_t *ground;
+static st_env_object *objects;
+static int *num_objects;
+static int *score_delta;
+static int *lives_delta;
+static uint8_t *done;
+
+static void parseCmdLine(int argc, char **argv);
+static void *alloc(size_t size);
+static uint8_t pickAction(int game, int step);
+static double getSecs();
+
+
+int main(int argc, char **argv)
+{
+	st_env_obs obs;
+	st_env *env;
+	double start;
+	double secs;
+	long total_score = 0;
+	long total_objects = 0;
+	int games_over = 0;
+	int step;
+	int g;
+
+	parseCmdLine(argc,argv);
+
+	actions = (uint8_t *)alloc(num_games);
+	ground = (uint8_t *)alloc(num_games * ENV_GROUND_CELLS);
+	objects = (st_env_object *)alloc(
+		num_games * ENV_MAX_OBJECTS * sizeof(st_env_object));
+	num_objects = (int *)alloc(num_games * sizeof(int));
+	score_delta = (int *)alloc(num_games * sizeof(int));
+	lives_delta = (int *)alloc(num_games * sizeof(int));
+	done = (uint8_t *)alloc(num_games);
+
+	obs.ground = ground;
+	obs.objects = objects;
+	obs.num_objects = num_objects;
+	obs.score_delta = score_delta;
+	obs.lives_delta = lives_delta;
+	obs.done = done;
+
+	env = envCreate(num_games,num_workers,seed);
+	envObserve(env,&obs);
+
+	start = getSecs();
+	for(step=0;step < num_steps;++step)
+	{
+		for(g=0;g < num_games;++g) actions[g] = pickAction(g,step);
+		envStep(env,actions,&obs);
+
+		for(g=0;g < num_games;++g)
+		{
+			total_score += score_delta[g];
+			total_objects += num_objects[g];
+			games_over += done[g];
+		}
+	}
+	secs = getSecs() - start;
+	envDestroy(env);
+
+	printf("Env: %d games on %d workers x %d steps in %.3f secs = "
+	       "%.0f steps/sec\n",
+		num_games,num_workers,num_steps,secs,
+		secs > 0 ? (double)num_games * num_steps / secs : 0);
+	printf("Score gained %ld, games over %d, %.1f objects/step\n",
+		total_score,games_over,
+		(double)total_objects / ((double)num_games * num_steps));
+	return 0;
+}
+
+
+
+
+void parseCmdLine(int argc, char **argv)
+{
+	int i;
+
+	num_games = 4;
+	num_workers = 1;
+	num_steps = 20000;
+	seed = 1;
+
+	for(i=1;i < argc;++i)
+	{
+		if (i == argc - 1) goto USAGE;
+
+		if (!strcmp(argv[i],"-games"))
+		{
+			if ((num_games = atoi(argv[++i])) < 1) goto USAGE;
+		}
+		else if (!strcmp(argv[i],"-workers"))
+		{
+			if ((num_workers = atoi(argv[++i])) < 1) goto USAGE;
+		}
+		else if (!strcmp(argv[i],"-steps"))
+		{
+			if ((num_steps = atoi(argv[++i])) < 1) goto USAGE;
+		}
+		else if (!strcmp(argv[i],"-seed"))
+			seed = strtoull(argv[++i],NULL,10);
+		else goto USAGE;
+	}
+	return;
+
+	USAGE:
+	printf("Usage: %s [-games <count>] [-workers <count>] [-steps <count>]\n"
+	       "       [-seed <number>]\n",argv[0]);
+	exit(1);
+}
+
+
+
+
+void *alloc(size_t size)
+{
+	void *ptr;
+
+	if (!(ptr = calloc(1,size)))
+	{
+		printf("ERROR: Out of memory\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+
+
+
+/*** Wander about changing direction every so often and keep throwing the
+     ball. Each game goes its own way. ***/
+uint8_t pickAction(int game, int step)
+{
+	static const uint8_t dirs[] = { ENV_LEFT, ENV_DOWN, ENV_RIGHT, ENV_UP };
+
+	return dirs[(step / 40 + game) % 4] | (step % 30 ? 0 : ENV_THROW);
+}
+
+
+
+
+double getSecs()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
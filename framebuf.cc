@@ -0,0 +1,197 @@
+// Software framebuffer. Everything is drawn into an MIT-SHM XImage in client
+// memory by raster.cc and put to the window with a single XShmPutImage() 
+// each frame instead of sending every line, arc and polygon to the X server.
+
+#include "globals.h"
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+
+static XImage *image;
+static XShmSegmentInfo shminfo;
+static int fb_width;
+static int fb_height;
+static int fb_stride;
+
+// Window image and copy of the background
+static uint32_t *fb_pixels;
+static uint32_t *fb_bg;
+
+static bool shm_error;
+
+static bool fbCreateImage();
+static void fbDestroyImage();
+static int fbErrorHandler(Display *disp, XErrorEvent *event);
+
+
+/*** See if the server supports shared memory and create the image. Returns
+     false if we can't use it. ***/
+bool fbInit()
+{
+	int major;
+	int minor;
+	Bool pixmaps;
+
+	if (!XShmQueryVersion(display,&major,&minor,&pixmaps))
+	{
+		printf("WARNING: Server does not support MIT-SHM.\n");
+		return false;
+	}
+	rasterInit();
+	return fbCreateImage();
+}
+
+
+
+
+/*** Create the shared image the size of the window. Only 32 bit pixels are
+     supported. ***/
+bool fbCreateImage()
+{
+	XErrorHandler old_handler;
+	int screen = DefaultScreen(display);
+
+	image = XShmCreateImage(
+		display,
+		DefaultVisual(display,screen),
+		DefaultDepth(display,screen),
+		ZPixmap,NULL,&shminfo,win_width,win_height);
+	if (!image)
+	{
+		printf("WARNING: XShmCreateImage() failed.\n");
+		return false;
+	}
+	if (image->bits_per_pixel != 32)
+	{
+		printf("WARNING: Shared memory drawing needs 32 bits per pixel, display has %d.\n",
+			image->bits_per_pixel);
+		XDestroyImage(image);
+		image = NULL;
+		return false;
+	}
+
+	shminfo.shmid = shmget(
+		IPC_PRIVATE,image->bytes_per_line * image->height,IPC_CREAT | 0600);
+	if (shminfo.shmid == -1)
+	{
+		perror("WARNING: shmget()");
+		XDestroyImage(image);
+		image = NULL;
+		return false;
+	}
+	shminfo.shmaddr = (char *)shmat(shminfo.shmid,NULL,0);
+	if (shminfo.shmaddr == (char *)-1)
+	{
+		perror("WARNING: shmat()");
+		XDestroyImage(image);
+		shmctl(shminfo.shmid,IPC_RMID,NULL);
+		image = NULL;
+		return false;
+	}
+	image->data = shminfo.shmaddr;
+	shminfo.readOnly = False;
+
+	// A remote server will say it has the extension but fail the attach
+	shm_error = false;
+	old_handler = XSetErrorHandler(fbErrorHandler);
+	XShmAttach(display,&shminfo);
+	XSync(display,False);
+	XSetErrorHandler(old_handler);
+
+	// Segment goes when we detach or exit
+	shmctl(shminfo.shmid,IPC_RMID,NULL);
+
+	if (shm_error)
+	{
+		printf("WARNING: XShmAttach() failed. Display is probably remote.\n");
+		XDestroyImage(image);
+		shmdt(shminfo.shmaddr);
+		image = NULL;
+		return false;
+	}
+
+	fb_width = image->width;
+	fb_height = image->height;
+	fb_stride = image->bytes_per_line / 4;
+	fb_pixels = (uint32_t *)image->data;
+	fb_bg = (uint32_t *)malloc(image->bytes_per_line * image->height);
+	assert(fb_bg);
+	fbTarget(false);
+
+	return true;
+}
+
+
+
+
+void fbDestroyImage()
+{
+	XShmDetach(display,&shminfo);
+	XDestroyImage(image);
+	shmdt(shminfo.shmaddr);
+	free(fb_bg);
+
+	image = NULL;
+	fb_pixels = NULL;
+	fb_bg = NULL;
+}
+
+
+
+
+int fbErrorHandler(Display *disp, XErrorEvent *event)
+{
+	shm_error = true;
+	return 0;
+}
+
+
+
+
+/*** Called at the start of each drawn frame. Recreates the image if the
+     window has been resized then clears it. ***/
+void fbClear()
+{
+	if (fb_width != win_width || fb_height != win_height)
+	{
+		fbDestroyImage();
+		if (!fbCreateImage())
+		{
+			printf("ERROR: Can't recreate shared memory image.\n");
+			exit(1);
+		}
+	}
+	memset(fb_pixels,0,image->bytes_per_line * image->height);
+}
+
+
+
+
+/*** Put the image to the window. Wait for the server to finish with it
+     before we start drawing the next frame into it. ***/
+void fbPresent()
+{
+	XShmPutImage(
+		display,
+		win,gc[COL_BLACK],image,0,0,0,0,fb_width,fb_height,False);
+	XSync(display,False);
+}
+
+
+
+
+/*** Draw into the background copy instead of the window image ***/
+void fbTarget(bool background)
+{
+	rasterTarget(background ? fb_bg : fb_pixels,fb_width,fb_height,fb_stride);
+}
+
+
+
+
+/*** Copy the background into the window image ***/
+void fbCopyBackground()
+{
+	memcpy(fb_pixels,fb_bg,image->bytes_per_line * image->height);
+}
@@ -0,0 +1,542 @@
+// Setting up games and running them a tick at a time. Kept apart from main.cc
+// so everything but the X front end can go in the env library.
+
+#define MAINFILE
+#include "globals.h"
+
+// Module forwards
+void run();
+void duringLevel();
+
+
+////////////////////////////////// START UP //////////////////////////////////
+
+/*** Set up the things shared by every game ***/
+void init()
+{
+	int i;
+	int j;
+
+	sprintf(version_text,"V%s, %s",VERSION,BUILD_DATE);
+	cl_player::initShapes();
+
+	// Set up ascii tables. Taken from peniten-6
+	for(i=0;i < 256;++i) ascii_table[i] = NULL;
+
+	ascii_table[(int)'A'] = (st_char_template *)&char_A;
+	ascii_table[(int)'B'] = (st_char_template *)&char_B;
+	ascii_table[(int)'C'] = (st_char_template *)&char_C;
+	ascii_table[(int)'D'] = (st_char_template *)&char_D;
+	ascii_table[(int)'E'] = (st_char_template *)&char_E;
+	ascii_table[(int)'F'] = (st_char_template *)&char_F;
+	ascii_table[(int)'G'] = (st_char_template *)&char_G;
+	ascii_table[(int)'H'] = (st_char_template *)&char_H;
+	ascii_table[(int)'I'] = (st_char_template *)&char_I;
+	ascii_table[(int)'J'] = (st_char_template *)&char_J;
+	ascii_table[(int)'K'] = (st_char_template *)&char_K;
+	ascii_table[(int)'L'] = (st_char_template *)&char_L;
+	ascii_table[(int)'M'] = (st_char_template *)&char_M;
+	ascii_table[(int)'N'] = (st_char_template *)&char_N;
+	ascii_table[(int)'O'] = (st_char_template *)&char_O;
+	ascii_table[(int)'P'] = (st_char_template *)&char_P;
+	ascii_table[(int)'Q'] = (st_char_template *)&char_Q;
+	ascii_table[(int)'R'] = (st_char_template *)&char_R;
+	ascii_table[(int)'S'] = (st_char_template *)&char_S;
+	ascii_table[(int)'T'] = (st_char_template *)&char_T;
+	ascii_table[(int)'U'] = (st_char_template *)&char_U;
+	ascii_table[(int)'V'] = (st_char_template *)&char_V;
+	ascii_table[(int)'W'] = (st_char_template *)&char_W;
+	ascii_table[(int)'X'] = (st_char_template *)&char_X;
+	ascii_table[(int)'Y'] = (st_char_template *)&char_Y;
+	ascii_table[(int)'Z'] = (st_char_template *)&char_Z;
+
+	ascii_table[(int)'a'] = (st_char_template *)&char_A;
+	ascii_table[(int)'b'] = (st_char_template *)&char_B;
+	ascii_table[(int)'c'] = (st_char_template *)&char_C;
+	ascii_table[(int)'d'] = (st_char_template *)&char_D;
+	ascii_table[(int)'e'] = (st_char_template *)&char_E;
+	ascii_table[(int)'f'] = (st_char_template *)&char_F;
+	ascii_table[(int)'g'] = (st_char_template *)&char_G;
+	ascii_table[(int)'h'] = (st_char_template *)&char_H;
+	ascii_table[(int)'i'] = (st_char_template *)&char_I;
+	ascii_table[(int)'j'] = (st_char_template *)&char_J;
+	ascii_table[(int)'k'] = (st_char_template *)&char_K;
+	ascii_table[(int)'l'] = (st_char_template *)&char_L;
+	ascii_table[(int)'m'] = (st_char_template *)&char_M;
+	ascii_table[(int)'n'] = (st_char_template *)&char_N;
+	ascii_table[(int)'o'] = (st_char_template *)&char_O;
+	ascii_table[(int)'p'] = (st_char_template *)&char_P;
+	ascii_table[(int)'q'] = (st_char_template *)&char_Q;
+	ascii_table[(int)'r'] = (st_char_template *)&char_R;
+	ascii_table[(int)'s'] = (st_char_template *)&char_S;
+	ascii_table[(int)'t'] = (st_char_template *)&char_T;
+	ascii_table[(int)'u'] = (st_char_template *)&char_U;
+	ascii_table[(int)'v'] = (st_char_template *)&char_V;
+	ascii_table[(int)'w'] = (st_char_template *)&char_W;
+	ascii_table[(int)'x'] = (st_char_template *)&char_X;
+	ascii_table[(int)'y'] = (st_char_template *)&char_Y;
+	ascii_table[(int)'z'] = (st_char_template *)&char_Z;
+
+	ascii_table[(int)'0'] = (st_char_template *)&char_0;
+	ascii_table[(int)'1'] = (st_char_template *)&char_1;
+	ascii_table[(int)'2'] = (st_char_template *)&char_2;
+	ascii_table[(int)'3'] = (st_char_template *)&char_3;
+	ascii_table[(int)'4'] = (st_char_template *)&char_4;
+	ascii_table[(int)'5'] = (st_char_template *)&char_5;
+	ascii_table[(int)'6'] = (st_char_template *)&char_6;
+	ascii_table[(int)'7'] = (st_char_template *)&char_7;
+	ascii_table[(int)'8'] = (st_char_template *)&char_8;
+	ascii_table[(int)'9'] = (st_char_template *)&char_9;
+
+	ascii_table[(int)' '] = (st_char_template *)&char_space;
+	ascii_table[(int)'?'] = (st_char_template *)&char_qmark;
+	ascii_table[(int)'!'] = (st_char_template *)&char_exmark;
+	ascii_table[(int)'+'] = (st_char_template *)&char_plus;
+	ascii_table[(int)'-'] = (st_char_template *)&char_minus;
+	ascii_table[(int)'*'] = (st_char_template *)&char_star;
+	ascii_table[(int)'='] = (st_char_template *)&char_equals;
+	ascii_table[(int)'.'] = (st_char_template *)&char_dot;
+	ascii_table[(int)','] = (st_char_template *)&char_comma;
+	ascii_table[(int)'('] = (st_char_template *)&char_lrbracket;
+	ascii_table[(int)')'] = (st_char_template *)&char_rrbracket;
+	ascii_table[(int)'{'] = (st_char_template *)&char_lcbracket;
+	ascii_table[(int)'}'] = (st_char_template *)&char_rcbracket;
+	ascii_table[(int)'['] = (st_char_template *)&char_lsbracket;
+	ascii_table[(int)']'] = (st_char_template *)&char_rsbracket;
+	ascii_table[(int)'$'] = (st_char_template *)&char_dollar;
+	ascii_table[(int)'#'] = (st_char_template *)&char_hash;
+	ascii_table[(int)'/'] = (st_char_template *)&char_fslash;
+	ascii_table[(int)'\\'] = (st_char_template *)&char_bslash;
+	ascii_table[(int)'>'] = (st_char_template *)&char_greater;
+	ascii_table[(int)'<'] = (st_char_template *)&char_less;
+	ascii_table[(int)'_'] = (st_char_template *)&char_underscore;
+	ascii_table[(int)'|'] = (st_char_template *)&char_bar;
+	ascii_table[(int)'\''] = (st_char_template *)&char_squote;
+	ascii_table[(int)'"'] = (st_char_template *)&char_dquote;
+	ascii_table[(int)'`'] = (st_char_template *)&char_bquote;
+	ascii_table[(int)':'] = (st_char_template *)&char_colon;
+	ascii_table[(int)';'] = (st_char_template *)&char_semicolon;
+	ascii_table[(int)'@'] = (st_char_template *)&char_at;
+	ascii_table[(int)'^'] = (st_char_template *)&char_hat;
+	ascii_table[(int)'~'] = (st_char_template *)&char_tilda;
+	ascii_table[(int)'&'] = (st_char_template *)&char_ampersand;
+	ascii_table[(int)'%'] = (st_char_template *)&char_percent;
+
+	// Adjust data values to have origin in centre , not top left. I'm
+	// too lazy to adjust all that data itself.
+	for(i=32;i < 256;++i)
+	{
+		// A & a , B & b etc share the same struct so don't do this
+		// operation twice on them
+		if (ascii_table[i] && (i < 'a' || i > 'z'))
+		{
+			for(j=0;j < ascii_table[i]->cnt;++j)
+			{
+				ascii_table[i]->data[j].x -= CHAR_HALF;
+				ascii_table[i]->data[j].y -= CHAR_HALF;
+			}
+		}
+	}
+}
+
+
+
+
+/*** Create a game, make it the current one and put it in attract mode ***/
+st_game *newGame(uint64_t game_seed)
+{
+	st_game *g;
+	int i;
+	int j;
+
+	g = new st_game();
+	setGame(g);
+	seedRandom(game_seed);
+
+	g->objects[0] = g->player = new cl_player;
+	g->objects[1] = g->ball = new cl_ball;
+
+	// Each class has its own contiguous pool. objects[] points into them.
+	g->nugget_pool = new cl_nugget[MAX_NUGGETS];
+	g->boulder_pool = new cl_boulder[MAX_BOULDERS];
+	g->spooky_pool = new cl_spooky[MAX_SPOOKYS];
+	g->spiky_pool = new cl_spiky[MAX_SPIKYS];
+	g->grubble_pool = new cl_grubble[MAX_GRUBBLES];
+	g->wurmal_pool = new cl_wurmal[MAX_WURMALS];
+
+	for(i=0,j=2;i < MAX_NUGGETS;++i,++j) g->objects[j] = &g->nugget_pool[i];
+	for(i=0;i < MAX_BOULDERS;++i,++j)
+	{
+		g->objects[j] = &g->boulder_pool[i];
+		g->boulder_pool[i].list_pos = i;
+	}
+	for(i=0;i < MAX_SPOOKYS;++i,++j)  g->objects[j] = &g->spooky_pool[i];
+	for(i=0;i < MAX_SPIKYS;++i,++j)   g->objects[j] = &g->spiky_pool[i];
+	for(i=0;i < MAX_GRUBBLES;++i,++j) g->objects[j] = &g->grubble_pool[i];
+	for(i=0;i < MAX_WURMALS;++i,++j)  g->objects[j] = &g->wurmal_pool[i];
+	initObjectLists();
+
+	// Stones belong in their own list since they do nothing and don't
+	// interact with any other objects
+	for(i=0;i < MAX_STONES;++i) g->stones[i] = new cl_stone;
+
+	g->attract_enemy[0] = new cl_spooky;
+	g->attract_enemy[1] = new cl_grubble;
+	g->attract_enemy[2] = new cl_wurmal;
+	g->attract_enemy[3] = new cl_spiky;
+
+	// Text object creation
+	g->text_digger = new cl_text(cl_text::TXT_DIGGER);
+	g->text_s_to_start = new cl_text(cl_text::TXT_S_TO_START);
+	g->text_copyright = new cl_text(cl_text::TXT_COPYRIGHT);
+	g->text_level_start = new cl_text(cl_text::TXT_LEVEL_START);
+	g->text_ready = new cl_text(cl_text::TXT_READY);
+	g->text_paused = new cl_text(cl_text::TXT_PAUSED);
+	g->text_game_over = new cl_text(cl_text::TXT_GAME_OVER);
+	g->text_invisibility_powerup =
+		new cl_text(cl_text::TXT_INVISIBILITY_POWERUP);
+	g->text_superball_powerup = new cl_text(cl_text::TXT_SUPERBALL_POWERUP);
+	g->text_freeze_powerup = new cl_text(cl_text::TXT_FREEZE_POWERUP);
+	g->text_new_high_score = new cl_text(cl_text::TXT_NEW_HIGH_SCORE);
+	g->text_bonus_life = new cl_text(cl_text::TXT_BONUS_LIFE);
+	g->text_got_spiky = new cl_text(cl_text::TXT_GOT_SPIKY);
+
+	for(i=0;i < NUM_BONUS_SCORES;++i)
+		g->text_bonus_score[i] = new cl_text(cl_text::TXT_BONUS_SCORE);
+
+	// Miscellanious
+	g->high_score = 10000;
+	g->done_high_score = false;
+	resetGameGlobals();
+
+	setGameStage(GAME_STAGE_ATTRACT_PLAY);
+	return g;
+}
+
+
+
+
+/*** Make g the game this thread runs ***/
+void setGame(st_game *g)
+{
+	game = g;
+}
+
+
+
+
+/*** Delete a game and everything it made. If it was the current game there
+     isn't one afterwards. ***/
+void freeGame(st_game *g)
+{
+	st_game *prev = (game == g ? NULL : game);
+	int i;
+
+	// freeTunnels() works on the current game
+	setGame(g);
+	freeTunnels();
+
+	delete g->player;
+	delete g->ball;
+	delete[] g->nugget_pool;
+	delete[] g->boulder_pool;
+	delete[] g->spooky_pool;
+	delete[] g->spiky_pool;
+	delete[] g->grubble_pool;
+	delete[] g->wurmal_pool;
+
+	for(i=0;i < MAX_STONES;++i) delete g->stones[i];
+	for(i=0;i < NUM_ATTRACT_ENEMIES;++i) delete g->attract_enemy[i];
+
+	delete g->text_digger;
+	delete g->text_s_to_start;
+	delete g->text_copyright;
+	delete g->text_level_start;
+	delete g->text_ready;
+	delete g->text_paused;
+	delete g->text_game_over;
+	delete g->text_invisibility_powerup;
+	delete g->text_superball_powerup;
+	delete g->text_freeze_powerup;
+	delete g->text_new_high_score;
+	delete g->text_bonus_life;
+	delete g->text_got_spiky;
+	for(i=0;i < NUM_BONUS_SCORES;++i) delete g->text_bonus_score[i];
+
+	delete g;
+	setGame(prev);
+}
+
+
+
+
+/*** Start a new game from attract mode ***/
+void startGame()
+{
+	game->level = 1;
+	resetGameGlobals();
+	setGameStage(GAME_STAGE_LEVEL_START);
+
+	// Echo switched off when player activated
+	echoOn();
+	playFGSound(SND_START);
+}
+
+
+
+
+/*** Reset some stuff not done in initLevel() ***/
+void resetGameGlobals()
+{
+	setScore(0);
+	setLives(3);
+	game->paused = false;
+	game->done_high_score = false;
+	game->bonus_life_score = BONUS_LIFE_INC;
+}
+
+
+////////////////////////////////// RUNTIME ///////////////////////////////////
+
+/*** Run and draw one tick when there's no mainloop ***/
+void gameTick()
+{
+	drawScreen(runGameStage());
+	if (!game->paused) ++game->game_stage_cnt;
+}
+
+
+
+
+/*** Switch on game stages and run whatever needs running for one tick ***/
+en_screen runGameStage()
+{
+	switch(game->game_stage)
+	{
+	case GAME_STAGE_ATTRACT_PLAY:
+		if (game->game_stage_cnt < 0) return SCREEN_ASCII_TABLE;
+
+		if (game->game_stage_cnt == 1000)
+			setGameStage(GAME_STAGE_ATTRACT_ENEMIES);
+		else
+			run();
+		break;
+
+	case GAME_STAGE_ATTRACT_ENEMIES:
+		if (game->game_stage_cnt == 300)
+		{
+			setGameStage(GAME_STAGE_ATTRACT_KEYS);
+			return SCREEN_NONE;
+		}
+		for(int i=0;i < NUM_ATTRACT_ENEMIES;++i)
+			game->attract_enemy[i]->attractRun();
+		return SCREEN_ENEMIES;
+
+	case GAME_STAGE_ATTRACT_KEYS:
+		if (game->game_stage_cnt == 200)
+		{
+			setGameStage(GAME_STAGE_ATTRACT_PLAY);
+			return SCREEN_NONE;
+		}
+		return SCREEN_KEYS;
+
+	case GAME_STAGE_LEVEL_START:
+		if (game->game_stage_cnt == 50)
+			setGameStage(GAME_STAGE_READY);
+		break;
+
+	case GAME_STAGE_READY:
+		if (game->game_stage_cnt == 50)
+			setGameStage(GAME_STAGE_PLAY);
+		break;
+
+	case GAME_STAGE_PLAY:
+		if (!game->paused) run();
+		break;
+
+	case GAME_STAGE_LEVEL_COMPLETE:
+		if (game->game_stage_cnt == 150)
+		{
+			++game->level;
+			setGroundColour();
+			setGameStage(GAME_STAGE_LEVEL_START);
+		}
+		else game->ground_colour = (game->game_stage_cnt * 2) % COL_GREEN2;
+		break;
+			
+	case GAME_STAGE_PLAYER_DIED:
+		if (game->game_stage_cnt == 10)
+			setGameStage(GAME_STAGE_READY);
+		break;
+
+	case GAME_STAGE_GAME_OVER:
+		if (game->game_stage_cnt == 250)
+		{
+			resetGameGlobals();
+			setGameStage(GAME_STAGE_ATTRACT_PLAY);
+		}
+		break;
+
+	default:
+		assert(0);
+	}
+	return SCREEN_GAME;
+}
+
+
+
+
+/*** Draw whatever runGameStage() said to then send anything that's been
+     batched up ***/
+void drawScreen(en_screen screen)
+{
+	switch(screen)
+	{
+	case SCREEN_NONE:
+		break;
+
+	case SCREEN_GAME:
+		drawGameScreen();
+		break;
+
+	case SCREEN_ASCII_TABLE:
+		drawAsciiTable();
+		break;
+
+	case SCREEN_ENEMIES:
+		drawEnemyScreen();
+		break;
+
+	case SCREEN_KEYS:
+		drawKeysScreen();
+		break;
+	}
+	endFrame();
+}
+
+
+
+
+/*** Run everything and check for collisions ***/
+void run()
+{
+	uint64_t start;
+
+	// If player has died flick ground colour and reset to appropriate 
+	// game stage
+	if (game->player->stage == STAGE_EXPLODE)
+	{
+		if (game->player->stage_cnt < 10)
+			game->ground_colour = getRandom(RAND_GFX) % NUM_FULL_COLOURS;
+		else if (game->player->stage_cnt == 100)
+		{
+			setGameStage(IN_ATTRACT_MODE() ? 
+			             GAME_STAGE_ATTRACT_ENEMIES : GAME_STAGE_PLAYER_DIED);
+			return;
+		}
+		else setGroundColour(); 
+	}
+
+	// Run objects
+	start = getMonoTime();
+	obj_run_cnt += runObjects();
+	obj_run_nsecs += getMonoTime() - start;
+	phaseAdd(PHASE_OBJ_RUN,start);
+
+	// Check for collions in a seperate loop so all objects have already
+	// run.
+	start = getMonoTime();
+	checkCollisions();
+	phaseAdd(PHASE_COLLISIONS,start);
+
+	start = getMonoTime();
+	duringLevel();
+	phaseAdd(PHASE_DURING_LEVEL,start);
+}
+
+
+
+
+/*** Timed events during a level. I use game_stage_cnt because its reset to 
+     zero each time player dies. ***/
+void duringLevel()
+{
+	if (!game->game_stage_cnt) return;
+
+	// Check for player completing level.
+	if (game->game_stage == GAME_STAGE_PLAY && !game->nugget_cnt)
+	{
+		setGameStage(GAME_STAGE_LEVEL_COMPLETE);
+		playFGSound(SND_LEVEL_COMPLETE);
+		return;
+	}
+
+	// Keep creating spookys at regular intervals
+	if (game->game_stage_cnt == game->first_spooky_cnt || 
+	    !(game->game_stage_cnt % game->spooky_create_mod)) 
+		activateObjects(TYPE_SPOOKY,1);
+
+	switch(game->level)
+	{
+	case 1:
+		if (game->game_stage_cnt == 500 || game->game_stage_cnt == 1000) 
+			activateObjects(TYPE_GRUBBLE,1);
+		break;
+
+	case 2:
+		if (game->game_stage_cnt == 400 || 
+		    game->game_stage_cnt == 800 ||
+		    game->game_stage_cnt == 1200) activateObjects(TYPE_GRUBBLE,1);
+		break;
+
+	case 3:
+		if (game->game_stage_cnt == 1)
+			activateObjects(TYPE_WURMAL,1 - game->wurmals_killed);
+		else
+		if (!(game->game_stage_cnt % 300)) activateObjects(TYPE_GRUBBLE,1);
+		break;
+
+	case 4:
+		if (game->game_stage_cnt == 1)
+			activateObjects(TYPE_WURMAL,1 - game->wurmals_killed);
+		else
+		if (!(game->game_stage_cnt % 300)) activateObjects(TYPE_GRUBBLE,1);
+
+		if (game->game_stage_cnt > 500 && !(getRandom(RAND_GAME) % 400))
+			activateObjectsTotal(TYPE_SPIKY,1);
+		break;
+
+	case 5:
+	case 6:
+		if (game->game_stage_cnt == 1)
+			activateObjects(TYPE_WURMAL,1 - game->wurmals_killed);
+		else
+		if (!(game->game_stage_cnt % 250)) activateObjects(TYPE_GRUBBLE,1);
+
+		if (game->game_stage_cnt > 500 && !(getRandom(RAND_GAME) % 300))
+			activateObjectsTotal(TYPE_SPIKY,1);
+		break;
+
+	case 7:
+	case 8:
+		if (game->game_stage_cnt == 1)
+			activateObjects(TYPE_WURMAL,2 - game->wurmals_killed);
+		else
+		if (!(game->game_stage_cnt % 200)) activateObjects(TYPE_GRUBBLE,1);
+
+		if (game->game_stage_cnt > 500 && !(getRandom(RAND_GAME) % 300))
+			activateObjects(TYPE_SPIKY,1);
+		break;
+
+	default:
+		if (game->game_stage_cnt == 1)
+			activateObjects(TYPE_WURMAL,2 - game->wurmals_killed);
+		else
+		if (!(game->game_stage_cnt % game->grubble_create_mod))
+			activateObjects(TYPE_GRUBBLE,1);
+
+		if (game->game_stage_cnt > 400 && !(getRandom(RAND_GAME) % 200))
+			activateObjects(TYPE_SPIKY,1);
+		break;
+	}
+}
@@ -9,6 +9,7 @@
 #include <time.h>
 #include <signal.h>
 #include <assert.h>
+#include <stdint.h>
 #include <sys/time.h>
 #include <sys/wait.h>
 
@@ -19,6 +20,8 @@
 
 #include <vector>
 #include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
 
 #include "build_date.h"
 
@@ -47,6 +50,24 @@ using namespace std;
 #define TUNNEL_WIDTH 50
 #define TUNNEL_HALF (TUNNEL_WIDTH / 2)
 
+/* tunnel_bitmap has 1 bit per pixel, set for ground, and is stored a row at 
+   a time. Coordinates must be on screen. ONSCREEN() does both tests with
+   one compare each. */
+#define BITMAP_WORDS    ((SCR_SIZE + 63) / 64)
+#define IS_GROUND(X,Y)  ((game->tunnel_bitmap[Y][(X) >> 6] >> ((X) & 63)) & 1)
+#define ONSCREEN(X,Y)   ((unsigned)(X) < SCR_SIZE && \
+                         (unsigned)((Y) - PLAY_AREA_TOP) < PLAY_AREA_HEIGHT)
+
+// Cells of the ground distance field in ground.cc. Must divide the play area.
+#define GROUND_CELL  5
+#define GROUND_COLS  (SCR_SIZE / GROUND_CELL)
+#define GROUND_ROWS  (PLAY_AREA_HEIGHT / GROUND_CELL)
+#define GROUND_CELLS (GROUND_COLS * GROUND_ROWS)
+
+// Cells of the tunnel spatial index in tunnels.cc
+#define TUN_CELL_SIZE TUNNEL_WIDTH
+#define TUN_CELLS     ((SCR_SIZE + TUN_CELL_SIZE - 1) / TUN_CELL_SIZE)
+
 #define MAX_NUGGETS   40
 #define MAX_BOULDERS  4
 #define MAX_SPOOKYS   10
@@ -147,7 +168,17 @@ enum en_game_stage
 	GAME_STAGE_GAME_OVER
 };
 
-#define IN_ATTRACT_MODE() (game_stage <= GAME_STAGE_ATTRACT_KEYS)
+#define IN_ATTRACT_MODE() (game->game_stage <= GAME_STAGE_ATTRACT_KEYS)
+
+// What gets drawn after a game tick
+enum en_screen
+{
+	SCREEN_NONE,
+	SCREEN_GAME,
+	SCREEN_ASCII_TABLE,
+	SCREEN_ENEMIES,
+	SCREEN_KEYS
+};
 
 // Not all stages used by all objects
 enum en_object_stage
@@ -183,7 +214,9 @@ enum en_type
 	TYPE_SPOOKY,
 	TYPE_SPIKY,
 	TYPE_GRUBBLE,
-	TYPE_WURMAL
+	TYPE_WURMAL,
+
+	NUM_TYPES
 };
 
 // Sounds in order of priority. Lowest -> highest.
@@ -226,10 +259,100 @@ enum en_sound
 	NUM_SOUNDS
 };
 
+// Parts of the mainloop that get timed
+enum en_phase
+{
+	PHASE_X_EVENTS,
+	PHASE_OBJ_RUN,
+	PHASE_COLLISIONS,
+	PHASE_DURING_LEVEL,
+	PHASE_DRAW,
+	PHASE_SWAP_BUFFERS,
+	PHASE_X_FLUSH,
+
+	NUM_PHASES
+};
+
+// Inputs in a recording. See replay.cc.
+enum en_input
+{
+	INPUT_KEY_PRESS,
+	INPUT_KEY_RELEASE,
+	INPUT_UNMAP,
+	INPUT_END
+};
+
+/* Random number streams. Each part of the program has its own so how often
+   things get drawn or sounds get played doesn't change what happens in the
+   game and a run can be repeated exactly with -seed. */
+enum en_rand_stream
+{
+	RAND_GAME,
+	RAND_AUTOPLAY,
+	RAND_GFX,
+	RAND_SOUND,
+
+	NUM_RAND_STREAMS
+};
+
+// Defined after st_game which holds the streams
+inline long getRandom(en_rand_stream stream);
+
 
 
 /////////////////////////////// MISC CLASSES //////////////////////////////////
 
+class cl_tunnel;
+
+/*** Something waiting for part of the ground to be dug away. Set up with
+     watchDigArea() then fillTunnelArea() sets dug if it digs any of it
+     until unwatchDigArea() is called. ***/
+struct st_dig_watch
+{
+	int x1;
+	int y1;
+	int x2;
+	int y2;
+	bool dug;
+	bool watching;
+};
+
+
+/* Every tunnel has a slot. When a tunnel is merged into another its slot 
+   forwards to that one so handles to it follow. Slots aren't reused until
+   initTunnels() which bumps every generation so old handles go NULL. */
+struct st_tunnel_slot
+{
+	cl_tunnel *tun;
+	uint32_t gen;
+	int fwd_slot;
+	uint32_t fwd_gen;
+};
+
+
+/*** Handle to a tunnel. Tunnels live in a slot array in tunnels.cc and 
+     this is the slot plus its generation when the handle was made. If the 
+     tunnel gets merged into another one the handle follows it and if the 
+     tunnels are all cleared down it becomes NULL. Converts to a plain 
+     pointer when used. ***/
+class cl_tunnel_ref
+{
+public:
+	int slot;
+	uint32_t gen;
+
+	cl_tunnel_ref(): slot(-1), gen(0) { }
+	cl_tunnel_ref(cl_tunnel *tun);
+
+	cl_tunnel *get() const;
+	bool merged() const;
+	void follow();
+
+	operator cl_tunnel *() const { return get(); }
+	cl_tunnel *operator->() const { return get(); }
+};
+
+
 /*** Tunnel class ***/
 class cl_tunnel
 {
@@ -244,10 +367,21 @@ public:
 	int min_y;
 
 	bool vert;
-	bool recursed;
+	int id;
+	int slot;
 	vector<cl_tunnel *> links;
+	unordered_set<cl_tunnel *> link_set;
 	cl_tunnel *alt;
 
+	// Where we are in the spatial index in tunnels.cc
+	bool indexed;
+	bool idx_vert;
+	int idx_coord;
+	int idx_cx1;
+	int idx_cy1;
+	int idx_cx2;
+	int idx_cy2;
+
 	cl_tunnel(int nx1, int ny1);
 
 	void update(int nx2, int ny2);
@@ -284,6 +418,7 @@ public:
 	bool rev;
 
 	cl_explosion(cl_object *own);
+	~cl_explosion();
 	void activate();
 	void reverse();
 	void runAndDraw();
@@ -343,12 +478,23 @@ public:
 
 /////////////////////////////// OBJECT CLASSES ////////////////////////////////
 
+class cl_object;
+
+/* The objects in objects[] are linked into an active or free list for their
+   type by setStage(). Both lists are kept in objects[] order. */
+struct st_obj_list
+{
+	cl_object *head;
+	cl_object *tail;
+	int cnt;
+};
+
 /*** Objects base class ***/
 class cl_object
 {
 public:
 	en_object_stage stage;
-	cl_tunnel *curr_tunnel;
+	cl_tunnel_ref curr_tunnel;
 	en_type type;
 	en_dir dir;
 	en_dir facing_dir;
@@ -364,7 +510,14 @@ public:
 	int radius;
 	int stage_cnt;
 
+	// Active or free list links. Only used if in objects[]
+	cl_object *list_prev;
+	cl_object *list_next;
+	int slot;
+	bool listed;
+
 	cl_object(en_type t);
+	virtual ~cl_object() { }
 
 	virtual void activate() = 0;
 	virtual void run() = 0;
@@ -388,6 +541,7 @@ public:
 	void setStage(en_object_stage stg);
 	double distToObject(cl_object *obj);
 	virtual double overlapDist(cl_object *obj);
+	virtual double boundRadius();
 };
 
 
@@ -411,7 +565,7 @@ public:
 	double xsize_inc;
 	double ysize_inc;
 	en_dir prev_dir;
-	cl_tunnel *prev_tunnel;
+	cl_tunnel_ref prev_tunnel;
 	cl_object *boulder;
 	int ball_ang_inc;
 	int invisible_timer;
@@ -422,7 +576,10 @@ public:
 	bool hit_object;
 	bool hit_edge;
 
+	static void initShapes();
+
 	cl_player();
+	~cl_player();
 
 	void activate();
 	void resetTimers();
@@ -452,8 +609,8 @@ class cl_boulder;
 class cl_enemy: public cl_object
 {
 public:
-	cl_tunnel *prev_tunnel;
-	cl_tunnel *next_tunnel;
+	cl_tunnel_ref prev_tunnel;
+	cl_tunnel_ref next_tunnel;
 	cl_explosion *explode;
 	cl_boulder *boulder;
 	en_dir prev_dir;
@@ -463,6 +620,7 @@ public:
 	double dist_to_player;
 	
 	cl_enemy(en_type t);
+	~cl_enemy();
 
 	void activate();
 	virtual void attractActivate();
@@ -476,7 +634,7 @@ public:
 	void pickPlayerDirTunnel();
 	void setDirection();
 	en_dir dirToTunnel(cl_tunnel *from, cl_tunnel *to);
-	void updateTunnelPtrs(cl_tunnel *oldtun, cl_tunnel *newtun);
+	void checkTunnelMerge();
 	void hitPlayerMove();
 
 	virtual void move() { }
@@ -603,10 +761,14 @@ public:
 	bool hit_boulder;
 	int head_diam;
 	int head_radius;
+	int clearance;
 	int eye_col;
 	int random_move_cnt;
 	int eating_time;
 
+	// Steps from each ground cell to the nugget
+	short path[GROUND_CELLS];
+
 	cl_wurmal();
 
 	void activate();
@@ -616,6 +778,11 @@ public:
 	void attractRun();
 	void stageRun();
 	void findNugget();
+	void nuggetCells(cl_object *nug, vector<int> &cells);
+	void buildPath();
+	bool followPath();
+	bool downhill(int cell);
+	void headForNugget();
 	void pickRandomMove();
 	void updateEyeAngle();
 	void updateEdges();
@@ -623,6 +790,7 @@ public:
 	bool outsideGround(double x, double y);
 	void haveCollided(cl_object *obj, double dist);
 	double overlapDist(cl_object *obj);
+	double boundRadius();
 	void draw();
 };
 
@@ -639,6 +807,7 @@ public:
 	int superball_cnt;
 
 	cl_ball();
+	~cl_ball();
 
 	void activate();
 	void run();
@@ -660,6 +829,7 @@ public:
 	bool fill;
 
 	cl_rock(en_type t);
+	~cl_rock();
 
 	void activate();
 	void run() { }
@@ -676,9 +846,9 @@ public:
 	cl_stone(): cl_rock(TYPE_STONE)
 	{
 		cl_rock::activate();
-		x = random() % SCR_SIZE;
-		y = PLAY_AREA_TOP + random() % PLAY_AREA_HEIGHT;	
-		col = random() % NUM_FULL_COLOURS;
+		x = getRandom(RAND_GFX) % SCR_SIZE;
+		y = PLAY_AREA_TOP + getRandom(RAND_GFX) % PLAY_AREA_HEIGHT;	
+		col = getRandom(RAND_GFX) % NUM_FULL_COLOURS;
 	}
 };
 
@@ -741,8 +911,10 @@ public:
 	int cant_push_cnt;
 	int fall_y;
 	int fall_check_add;
+	st_dig_watch fall_watch;
 
 	cl_boulder();
+	~cl_boulder();
 
 	void activate();
 	void resetFallCheck();
@@ -1476,81 +1648,28 @@ EXTERN st_char_template *ascii_table[256];
 
 ////////////////////////////////// GLOBALS ///////////////////////////////////
 
+// Shared by the whole process. Only the thread with the window draws.
 EXTERN Display *display;
 EXTERN Window win;
 EXTERN Drawable drw;
 EXTERN GC gc[NUM_COLOURS];
 EXTERN XColor xcol[NUM_COLOURS];
 EXTERN XdbeSwapInfo swapinfo;
-EXTERN XPoint tmp_points[MAX_TMP_POINTS];
-
-EXTERN en_game_stage game_stage;
 
 EXTERN char *alsa_device;
-EXTERN int ground_colour;
-EXTERN int game_stage_cnt;
-EXTERN int level;
-EXTERN int lives;
-EXTERN int lives_at_level_start;
-EXTERN int score;
-EXTERN int high_score;
-EXTERN int level_cnt;
-EXTERN int nugget_cnt;
 EXTERN int win_width;
 EXTERN int win_height;
 EXTERN int win_refresh;
 EXTERN int refresh_cnt;
-EXTERN int eating_time;
-EXTERN int invisible_powerup_cnt;
-EXTERN int superball_powerup_cnt;
-EXTERN int freeze_powerup_cnt;
-EXTERN int bonus_nugget_cnt;
-EXTERN int turbo_enemy_powerup_cnt;
-EXTERN int spooky_create_mod;
-EXTERN int grubble_create_mod;
-EXTERN int first_spooky_cnt;
-EXTERN int bonus_life_score;
-EXTERN int wurmals_killed;
-EXTERN int end_of_level_bonus;
 
 EXTERN double x_scaling;
 EXTERN double y_scaling;
 EXTERN double avg_scaling;
-EXTERN double materialise_y_add;
-
-EXTERN bool paused;
-EXTERN bool done_high_score;
-
-EXTERN char tunnel_bitmap[SCR_SIZE][SCR_SIZE];
-EXTERN cl_object *objects[MAX_OBJECTS];
-EXTERN cl_object *stones[MAX_STONES];
-EXTERN cl_enemy *attract_enemy[NUM_ATTRACT_ENEMIES];
-EXTERN cl_player *player;
-EXTERN cl_ball *ball;
-EXTERN cl_molehill molehill[NUM_MOLEHILLS];
-EXTERN vector<cl_tunnel *> tunnels;
-
-EXTERN cl_text *text_digger;
-EXTERN cl_text *text_copyright;
-EXTERN cl_text *text_s_to_start;
-EXTERN cl_text *text_level_start;
-EXTERN cl_text *text_ready;
-EXTERN cl_text *text_paused;
-EXTERN cl_text *text_game_over;
-EXTERN cl_text *text_got_spiky;
-EXTERN cl_text *text_bonus_score[NUM_BONUS_SCORES];
-EXTERN cl_text *text_invisibility_powerup;
-EXTERN cl_text *text_superball_powerup;
-EXTERN cl_text *text_freeze_powerup;
-EXTERN cl_text *text_new_high_score;
-EXTERN cl_text *text_bonus_life;
-
-EXTERN char score_text[10];
-EXTERN char high_score_text[10];
-EXTERN char lives_text[10];
-EXTERN char level_text[10];
+
+EXTERN bool use_shm;
+EXTERN bool virtual_dispatch;
+
 EXTERN char version_text[50];
-EXTERN char end_of_level_bonus_str[20];
 
 #ifdef SOUND
 EXTERN bool do_sound;
@@ -1558,9 +1677,159 @@ EXTERN bool do_fragment;
 EXTERN bool do_soundtest;
 #endif
 
+/* Everything belonging to a game. Any number can exist and a thread runs one
+   at a time, the one game points to. Made with newGame() and switched
+   between with setGame(). */
+struct st_game
+{
+	en_game_stage game_stage;
+
+	int ground_colour;
+	int game_stage_cnt;
+	int level;
+	int lives;
+	int lives_at_level_start;
+	int score;
+	int high_score;
+	int level_cnt;
+	int nugget_cnt;
+	int eating_time;
+	int invisible_powerup_cnt;
+	int superball_powerup_cnt;
+	int freeze_powerup_cnt;
+	int bonus_nugget_cnt;
+	int turbo_enemy_powerup_cnt;
+	int spooky_create_mod;
+	int grubble_create_mod;
+	int first_spooky_cnt;
+	int bonus_life_score;
+	int wurmals_killed;
+	int end_of_level_bonus;
+
+	// Which of the two layouts the boulders are using this level
+	int boulder_layout;
+
+	uint64_t rand_seed;
+	uint64_t rand_state[NUM_RAND_STREAMS][4];
+
+	double materialise_y_add;
+
+	bool paused;
+	bool done_high_score;
+
+	uint64_t tunnel_bitmap[SCR_SIZE][BITMAP_WORDS];
+	cl_object *objects[MAX_OBJECTS];
+	st_obj_list active_list[NUM_TYPES];
+	st_obj_list free_list[NUM_TYPES];
+	cl_nugget *nugget_pool;
+	cl_boulder *boulder_pool;
+	cl_spooky *spooky_pool;
+	cl_spiky *spiky_pool;
+	cl_grubble *grubble_pool;
+	cl_wurmal *wurmal_pool;
+	cl_object *stones[MAX_STONES];
+	cl_enemy *attract_enemy[NUM_ATTRACT_ENEMIES];
+	cl_player *player;
+	cl_ball *ball;
+	cl_molehill molehill[NUM_MOLEHILLS];
+	vector<cl_tunnel *> tunnels;
+
+	cl_text *text_digger;
+	cl_text *text_copyright;
+	cl_text *text_s_to_start;
+	cl_text *text_level_start;
+	cl_text *text_ready;
+	cl_text *text_paused;
+	cl_text *text_game_over;
+	cl_text *text_got_spiky;
+	cl_text *text_bonus_score[NUM_BONUS_SCORES];
+	cl_text *text_invisibility_powerup;
+	cl_text *text_superball_powerup;
+	cl_text *text_freeze_powerup;
+	cl_text *text_new_high_score;
+	cl_text *text_bonus_life;
+
+	char score_text[10];
+	char high_score_text[10];
+	char lives_text[10];
+	char level_text[10];
+	char end_of_level_bonus_str[20];
+
+	// Tunnel slots and paths between tunnels. See tunnels.cc.
+	vector<st_tunnel_slot> tunnel_slots;
+	int slots_used;
+	vector<int> path_dist;
+	vector<int> path_next;
+	int num_paths;
+	bool paths_valid;
+	vector<int> player_dist;
+	cl_tunnel *player_dist_tun;
+	bool player_dist_valid;
+
+	// tunnel_bitmap stored by column and the tunnel spatial index
+	uint64_t tunnel_cols[SCR_SIZE][BITMAP_WORDS];
+	unordered_map<int,vector<cl_tunnel *>> collinear[2];
+	vector<cl_tunnel *> tun_grid[TUN_CELLS][TUN_CELLS];
+	vector<st_dig_watch *> dig_watches;
+
+	// See ground.cc
+	uint8_t ground_dist[GROUND_CELLS];
+};
+
+EXTERN thread_local st_game *game;
+
+/* Per thread rather than per game. Module statics only used during a call,
+   eg search buffers, are thread_local for the same reason. */
+EXTERN thread_local XPoint tmp_points[MAX_TMP_POINTS];
+EXTERN thread_local bool do_draw;
+EXTERN thread_local uint64_t obj_run_nsecs;
+EXTERN thread_local uint64_t obj_run_cnt;
+
+/*** xoshiro256**. Returns 0 to 2^31 - 1 the same as random() so it can be
+     used the same way. Inline as it gets called per sample in sound.cc. ***/
+inline long getRandom(en_rand_stream stream)
+{
+	uint64_t *s = game->rand_state[stream];
+	uint64_t res = s[1] * 5;
+	uint64_t t = s[1] << 17;
+
+	res = ((res << 7) | (res >> 57)) * 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 45) | (s[3] >> 19);
+
+	return (long)(res >> 33);
+}
+
 //////////////////////////// FORWARD DECLARATIONS ////////////////////////////
 
+// game.cc
+void init();
+st_game *newGame(uint64_t game_seed);
+void setGame(st_game *g);
+void freeGame(st_game *g);
+void startGame();
+void resetGameGlobals();
+void gameTick();
+en_screen runGameStage();
+void drawScreen(en_screen screen);
+
+// cl_object.cc
+void initObjectLists();
+cl_object *firstActiveObject();
+cl_object *nextActiveObject(cl_object *obj);
+int  runObjects();
+void drawObjects();
+
+// collide.cc
+void checkCollisions();
+void collideReport();
+
 // common.cc
+void seedRandom(uint64_t seed);
 void setGameStage(en_game_stage stg);
 void initLevel();
 void deactivateAllObjects();
@@ -1581,20 +1850,48 @@ bool offscreen(int x, int y);
 
 // tunnels.cc
 cl_tunnel *createTunnel(int x, int y);
+void mergeTunnel(cl_tunnel *from, cl_tunnel *into);
 void initTunnels();
+void freeTunnels();
 void fillTunnelArea(int x1, int y1, int x2, int y2);
+void watchDigArea(st_dig_watch *watch, int x1, int y1, int x2, int y2);
+void unwatchDigArea(st_dig_watch *watch);
 bool outsideTunnel(int x, int y);
 bool insideTunnel(int x, int y);
+int  wallDistX(int x, int y, int add, int len);
+int  wallDistY(int x, int y, int add, int len);
+void invalidatePaths();
 int findShortestPath(
-	int depth,
-	int max_depth, cl_tunnel *from, cl_tunnel *to, cl_tunnel *&next);
+	int max_depth, cl_tunnel *from, cl_tunnel *to, cl_tunnel_ref &next);
+int findPathToPlayer(int max_depth, cl_tunnel *from, cl_tunnel_ref &next);
+void indexTunnel(cl_tunnel *tun);
+void unindexTunnel(cl_tunnel *tun);
+vector<cl_tunnel *> &collinearTunnels(bool vert, int coord);
+void nearTunnels(cl_tunnel *tun, vector<cl_tunnel *> &near);
+
+// ground.cc
+void groundInit();
+void groundDig(int x1, int y1, int x2, int y2);
+int  groundCell(double x, double y);
+int  groundNeighbour(int cell, int dx, int dy);
+int  groundClearance(int cell);
+void groundCellsNear(double x, double y, double range, vector<int> &cells);
+void groundDistances(vector<int> &start, int clearance, short *dist);
+bool groundStepOK(int cell, int dx, int dy, int clearance);
+void groundCopy(uint8_t *out);
 
 // draw.cc
 void drawAsciiTable();
 void drawGameScreen();
 void drawEnemyScreen();
 void drawKeysScreen();
+void drawBackground();
+void digBackground(int x1, int y1, int x2, int y2);
+void invalidateBackground();
 void drawLine(int col, double thick, double x1, double y1, double x2, double y2);
+void flushLines();
+void endFrame();
+void drawReport();
 void drawOrFillCircle(
 	int col, double thick, double diam, double x, double y, bool fill);
 void drawOrFillPolygon(
@@ -1615,6 +1912,46 @@ void drawChar(
 	int thick,
 	double ang, double x_scale, double y_scale, double x, double y);
 
+// framebuf.cc
+bool fbInit();
+void fbClear();
+void fbPresent();
+void fbTarget(bool background);
+void fbCopyBackground();
+
+// raster.cc
+void rasterInit();
+bool rasterSetKernel(const char *name);
+const char *rasterKernelName();
+void rasterTarget(uint32_t *pixels, int width, int height, int stride);
+void rasterLine(int col, int width, int x1, int y1, int x2, int y2);
+void rasterSegments(int col, int width, XSegment *seg, int cnt);
+void rasterFillRectangle(int col, int x, int y, int w, int h);
+void rasterDrawRectangle(int col, int width, int x, int y, int w, int h);
+void rasterFillPolygon(int col, XPoint *points, int num_points);
+void rasterDrawPolygon(int col, int width, XPoint *points, int num_points);
+void rasterDrawOrFillEllipse(int col, int width, int x, int y, int w, int h);
+
+// timing.cc
+uint64_t getMonoTime();
+void schedInit();
+int schedTicksDue();
+void schedWait();
+void schedReport();
+void phaseInit();
+void phaseAdd(en_phase phase, uint64_t start);
+void phaseCheckSignal();
+void phaseReport();
+
+// replay.cc
+void recordStart(const char *filename, uint64_t seed);
+void recordInput(en_input type, KeySym ksym);
+uint64_t replayStart(const char *filename);
+bool replaying();
+u_long replayLength();
+bool replayInput(en_input &type, KeySym &ksym);
+void inputTick();
+
 // sound.cc
 void startSoundDaemon();
 void playFGSound(en_sound snd);
@@ -0,0 +1,252 @@
+// How far the ground is from the nearest tunnel or edge of the play area on a
+// grid of GROUND_CELL pixel cells. Digging can only ever make it smaller so
+// fillTunnelArea() updates it by spreading out from the cells just dug
+// instead of working the whole thing out again.
+
+#include "globals.h"
+
+/* The field is st_game::ground_dist. Chebyshev distance in cells to the
+   nearest cell with any tunnel in it. 0 if there's tunnel in the cell
+   itself. Off the play area counts as tunnel. */
+
+// Search scratch
+static thread_local vector<int> queue;
+
+static void spreadDist();
+
+
+/*** Called whenever tunnel_bitmap is reset to solid ground ***/
+void groundInit()
+{
+	int cx;
+	int cy;
+
+	for(cy=0;cy < GROUND_ROWS;++cy)
+	{
+		for(cx=0;cx < GROUND_COLS;++cx)
+		{
+			game->ground_dist[cy * GROUND_COLS + cx] = 1 + min(
+				min(cx,GROUND_COLS - 1 - cx),
+				min(cy,GROUND_ROWS - 1 - cy));
+		}
+	}
+}
+
+
+
+
+/*** An area has been dug. Clips to the play area. ***/
+void groundDig(int x1, int y1, int x2, int y2)
+{
+	int cx1;
+	int cy1;
+	int cx2;
+	int cy2;
+	int cx;
+	int cy;
+	int c;
+
+	x1 = max(x1,0);
+	x2 = min(x2,SCR_SIZE - 1);
+	y1 = max(y1,PLAY_AREA_TOP);
+	y2 = min(y2,SCR_SIZE - 1);
+	if (x1 > x2 || y1 > y2) return;
+
+	cx1 = x1 / GROUND_CELL;
+	cx2 = x2 / GROUND_CELL;
+	cy1 = (y1 - PLAY_AREA_TOP) / GROUND_CELL;
+	cy2 = (y2 - PLAY_AREA_TOP) / GROUND_CELL;
+
+	queue.clear();
+	for(cy=cy1;cy <= cy2;++cy)
+	{
+		for(cx=cx1;cx <= cx2;++cx)
+		{
+			c = cy * GROUND_COLS + cx;
+			if (game->ground_dist[c])
+			{
+				game->ground_dist[c] = 0;
+				queue.push_back(c);
+			}
+		}
+	}
+	spreadDist();
+}
+
+
+
+
+/*** Breadth first out from the cells in the queue, which all have the same
+     distance, lowering anything that's now nearer a tunnel. Stops where
+     nothing changes so only the cells that need it get touched. ***/
+void spreadDist()
+{
+	size_t q;
+	int cell;
+	int dist;
+	int dx;
+	int dy;
+	int n;
+
+	for(q=0;q < queue.size();++q)
+	{
+		cell = queue[q];
+		dist = game->ground_dist[cell] + 1;
+
+		for(dy=-1;dy <= 1;++dy)
+		{
+			for(dx=-1;dx <= 1;++dx)
+			{
+				n = groundNeighbour(cell,dx,dy);
+				if (n != -1 && game->ground_dist[n] > dist)
+				{
+					game->ground_dist[n] = dist;
+					queue.push_back(n);
+				}
+			}
+		}
+	}
+}
+
+
+
+
+/*** Returns the cell a point is in or -1 if it's off the play area ***/
+int groundCell(double x, double y)
+{
+	int ix = (int)x;
+	int iy = (int)y;
+
+	if (!ONSCREEN(ix,iy)) return -1;
+	return (iy - PLAY_AREA_TOP) / GROUND_CELL * GROUND_COLS +
+	       ix / GROUND_CELL;
+}
+
+
+
+
+/*** Returns -1 if it's off the grid ***/
+int groundNeighbour(int cell, int dx, int dy)
+{
+	int cx = cell % GROUND_COLS + dx;
+	int cy = cell / GROUND_COLS + dy;
+
+	if ((unsigned)cx >= GROUND_COLS || (unsigned)cy >= GROUND_ROWS)
+		return -1;
+	return cy * GROUND_COLS + cx;
+}
+
+
+
+
+/*** Every pixel in the cell is at least this many pixels from the nearest
+     tunnel pixel going by the larger of the x and y distances ***/
+int groundClearance(int cell)
+{
+	int dist = game->ground_dist[cell];
+	return dist ? (dist - 1) * GROUND_CELL + 1 : 0;
+}
+
+
+
+
+/*** Centres of the cells within range of a point ***/
+void groundCellsNear(double x, double y, double range, vector<int> &cells)
+{
+	int cx1 = max((int)floor((x - range) / GROUND_CELL),0);
+	int cx2 = min((int)floor((x + range) / GROUND_CELL),GROUND_COLS - 1);
+	int cy1 = max((int)floor((y - PLAY_AREA_TOP - range) / GROUND_CELL),0);
+	int cy2 = min(
+		(int)floor((y - PLAY_AREA_TOP + range) / GROUND_CELL),
+		GROUND_ROWS - 1);
+	double mx;
+	double my;
+	int cx;
+	int cy;
+
+	cells.clear();
+	for(cy=cy1;cy <= cy2;++cy)
+	{
+		my = PLAY_AREA_TOP + cy * GROUND_CELL + GROUND_CELL / 2.0;
+		for(cx=cx1;cx <= cx2;++cx)
+		{
+			mx = cx * GROUND_CELL + GROUND_CELL / 2.0;
+			if (hypot(mx - x,my - y) <= range)
+				cells.push_back(cy * GROUND_COLS + cx);
+		}
+	}
+}
+
+
+
+
+/*** Distance in steps from the start cells to every cell that can be reached
+     from them through cells with at least the given clearance. -1 if it
+     can't be. A diagonal step needs both cells beside it clear too so
+     anything following the distances downhill never clips a corner. The
+     start cells don't need to be clear themselves. ***/
+void groundDistances(vector<int> &start, int clearance, short *dist)
+{
+	size_t q;
+	int cell;
+	int dx;
+	int dy;
+	int n;
+
+	for(n=0;n < GROUND_CELLS;++n) dist[n] = -1;
+
+	queue.clear();
+	for(auto c: start)
+	{
+		if (dist[c] == -1)
+		{
+			dist[c] = 0;
+			queue.push_back(c);
+		}
+	}
+
+	for(q=0;q < queue.size();++q)
+	{
+		cell = queue[q];
+		for(dy=-1;dy <= 1;++dy)
+		{
+			for(dx=-1;dx <= 1;++dx)
+			{
+				n = groundNeighbour(cell,dx,dy);
+				if (n == -1 ||
+				    dist[n] != -1 ||
+				    !groundStepOK(cell,dx,dy,clearance)) continue;
+
+				dist[n] = dist[cell] + 1;
+				queue.push_back(n);
+			}
+		}
+	}
+}
+
+
+
+
+/*** Whether the cell next to this one in the given direction has the
+     clearance along with the two beside it if it's a diagonal ***/
+bool groundStepOK(int cell, int dx, int dy, int clearance)
+{
+	int n = groundNeighbour(cell,dx,dy);
+
+	if (n == -1 || groundClearance(n) < clearance) return false;
+	if (dx && dy)
+	{
+		return groundClearance(groundNeighbour(cell,dx,0)) >= clearance &&
+		       groundClearance(groundNeighbour(cell,0,dy)) >= clearance;
+	}
+	return true;
+}
+
+
+
+
+/*** Copy the whole field out. It's stored a row at a time. ***/
+void groundCopy(uint8_t *out)
+{
+	memcpy(out,game->ground_dist,sizeof(game->ground_dist));
+}
@@ -6,26 +6,37 @@
  Copyright (C) Neil Robertson 2011-2023
  *****************************************************************************/
 
-#define MAINFILE
 #include "globals.h"
 
-#define MAINLOOP_DELAY 20000
+#include <thread>
+#include <errno.h>
+#include <ctype.h>
+
+#define HEADLESS_TICKS 10000
 
 // Module forwards
 void parseCmdLine(int argc, char **argv);
 void Xinit();
-void init();
-void resetGameGlobals();
+void threadedloop();
+void threadGame(uint64_t game_seed, int *result);
 
 void mainloop();
-u_int getTime();
+void headlessloop();
 void processXEvents();
-void run();
-void duringLevel();
+void keyPress(KeySym ksym);
+void keyRelease(KeySym ksym);
+void windowUnmapped();
+void replayTick();
 
 // Local modules variables
 char *disp;
 bool use_db;
+bool headless;
+int headless_ticks;
+uint64_t seed;
+char *record_file;
+char *replay_file;
+int num_threads;
 
 
 ///////////////////////////////// START UP /////////////////////////////////
@@ -33,6 +44,35 @@ bool use_db;
 int main(int argc, char **argv)
 {
 	parseCmdLine(argc,argv);
+
+	// A replay has to use the seed it was recorded with
+	if (replay_file) seed = replayStart(replay_file);
+
+	// Timings are per thread so there'd be nothing to report in the main
+	// one when games are run in their own threads
+	phaseInit();
+	if (num_threads == 1) atexit(phaseReport);
+
+	// No X and no sound. Just run the game as fast as possible.
+	if (headless)
+	{
+		if (replay_file) headless_ticks = replayLength();
+		if (record_file) recordStart(record_file,seed);
+		setScaling();
+		init();
+		if (num_threads > 1) threadedloop();
+		else
+		{
+			newGame(seed);
+			headlessloop();
+		}
+		return 0;
+	}
+
+	// Made before the sound daemon forks as it uses the game's sound
+	// random stream
+	init();
+	newGame(seed);
 #ifdef SOUND
 	startSoundDaemon();
 	if (do_soundtest)
@@ -43,8 +83,10 @@ int main(int argc, char **argv)
 		exit(0);
 	}
 #endif
+	// Not opened until the sound daemon has forked so it doesn't get a
+	// copy of the file
+	if (record_file) recordStart(record_file,seed);
 	Xinit();
-	init();
 	mainloop();
 	return 0;
 }
@@ -61,6 +103,14 @@ void parseCmdLine(int argc, char **argv)
 		"size",
 		"ref",
 		"nodb",
+		"shm",
+		"headless",
+		"ticks",
+		"virtual",
+		"seed",
+		"record",
+		"replay",
+		"threads",
 #ifdef SOUND
 		"nosnd",
 		"nofrag",
@@ -77,6 +127,14 @@ void parseCmdLine(int argc, char **argv)
 		OPT_SIZE,
 		OPT_REF,
 		OPT_NODB,
+		OPT_SHM,
+		OPT_HEADLESS,
+		OPT_TICKS,
+		OPT_VIRTUAL,
+		OPT_SEED,
+		OPT_RECORD,
+		OPT_REPLAY,
+		OPT_THREADS,
 #ifdef SOUND
 		OPT_NOSND,
 		OPT_NOFRAG,
@@ -89,6 +147,7 @@ void parseCmdLine(int argc, char **argv)
 
 		OPT_END
 	};
+	char *end;
 	int i,o;
 
 	disp = NULL;
@@ -96,6 +155,14 @@ void parseCmdLine(int argc, char **argv)
 	win_height = SCR_SIZE;
 	win_refresh = 1;
 	use_db = true;
+	use_shm = false;
+	headless = false;
+	headless_ticks = HEADLESS_TICKS;
+	virtual_dispatch = false;
+	seed = time(0);
+	record_file = NULL;
+	replay_file = NULL;
+	num_threads = 1;
 #ifdef SOUND
 	do_sound = true;
 	do_fragment = true;
@@ -130,6 +197,18 @@ void parseCmdLine(int argc, char **argv)
 		case OPT_NODB:
 			use_db = false;
 			continue;
+
+		case OPT_SHM:
+			use_shm = true;
+			continue;
+
+		case OPT_HEADLESS:
+			headless = true;
+			continue;
+
+		case OPT_VIRTUAL:
+			virtual_dispatch = true;
+			continue;
 #ifdef SOUND
 		case OPT_NOSND:
 			do_sound = false;
@@ -161,6 +240,28 @@ void parseCmdLine(int argc, char **argv)
 			if ((win_refresh = atoi(argv[i])) < 1) goto USAGE;
 			break;
 
+		case OPT_TICKS:
+			if ((headless_ticks = atoi(argv[i])) < 1) goto USAGE;
+			break;
+
+		case OPT_SEED:
+			errno = 0;
+			seed = strtoull(argv[i],&end,10);
+			if (!isdigit(argv[i][0]) || *end || errno) goto USAGE;
+			break;
+
+		case OPT_RECORD:
+			record_file = argv[i];
+			break;
+
+		case OPT_REPLAY:
+			replay_file = argv[i];
+			break;
+
+		case OPT_THREADS:
+			if ((num_threads = atoi(argv[i])) < 1) goto USAGE;
+			break;
+
 #ifdef ALSA
 		case OPT_ADEV:
 			alsa_device = argv[i];
@@ -171,6 +272,11 @@ void parseCmdLine(int argc, char **argv)
 			goto USAGE;
 		}
 	}
+	// Can't record and replay at once and neither works with threads.
+	// Threads are only for headless games.
+	if ((record_file && replay_file) ||
+	    (num_threads > 1 &&
+	     (!headless || record_file || replay_file))) goto USAGE;
 	return;
 
 	USAGE:
@@ -189,12 +295,28 @@ void parseCmdLine(int argc, char **argv)
 	       "       -sndtest            : Play all the sound effects then exit.\n"
 #endif
 	       "       -nodb               : Don't use double buffering. For really old systems.\n"
+	       "       -shm                : Draw into a shared memory image and put it to the\n"
+	       "                             window once a frame. Local displays only.\n"
+	       "       -headless           : Run the game simulation flat out with no X display\n"
+	       "                             or sound then print the ticks per second.\n"
+	       "       -ticks <count>      : Number of ticks to run in headless mode. Default = %d\n"
+	       "       -threads <count>    : Run this many separate games at once in headless\n"
+	       "                             mode, one per thread. Each is seeded with the\n"
+	       "                             seed plus its thread number.\n"
+	       "       -virtual            : Run and draw objects through virtual calls instead\n"
+	       "                             of per class pools. For benchmarking.\n"
+	       "       -seed <number>      : Seed for the random numbers so a run can be\n"
+	       "                             repeated. Default = the current time\n"
+	       "       -record <file>      : Save the seed and every key pressed to the file.\n"
+	       "       -replay <file>      : Play a recording back instead of reading the\n"
+	       "                             keyboard. With -headless runs for as many ticks\n"
+	       "                             as were recorded.\n"
 	       "       -ver                : Print version info then exit\n",
 		argv[0]
 #ifdef ALSA
 		,ALSA_DEVICE
 #endif
-		);
+		,HEADLESS_TICKS);
 	exit(1);
 }
 
@@ -372,6 +494,15 @@ void Xinit()
 		}
 	}
 
+	// The image is only put to the window when its complete so doesn't
+	// need double buffering
+	if (use_shm && !fbInit())
+	{
+		printf("WARNING: Falling back to X drawing.\n");
+		use_shm = false;
+	}
+	if (use_shm) use_db = false;
+
 	if (use_db)
 	{
 		drw = (Drawable)XdbeAllocateBackBufferName(
@@ -393,320 +524,157 @@ void Xinit()
 }
 
 
+////////////////////////////////// RUNTIME ///////////////////////////////////
 
 
-/*** Set up pretty much everything non X related ***/
-void init()
+/*** Get the events and draw the points ***/
+void mainloop()
 {
+	en_screen screen;
+	uint64_t start;
+	int ticks;
 	int i;
-	int j;
-
-	sprintf(version_text,"V%s, %s",VERSION,BUILD_DATE);
-
-	srandom(time(0));
-
-	// Set up ascii tables. Taken from peniten-6
-	for(i=0;i < 256;++i) ascii_table[i] = NULL;
-
-	ascii_table[(int)'A'] = (st_char_template *)&char_A;
-	ascii_table[(int)'B'] = (st_char_template *)&char_B;
-	ascii_table[(int)'C'] = (st_char_template *)&char_C;
-	ascii_table[(int)'D'] = (st_char_template *)&char_D;
-	ascii_table[(int)'E'] = (st_char_template *)&char_E;
-	ascii_table[(int)'F'] = (st_char_template *)&char_F;
-	ascii_table[(int)'G'] = (st_char_template *)&char_G;
-	ascii_table[(int)'H'] = (st_char_template *)&char_H;
-	ascii_table[(int)'I'] = (st_char_template *)&char_I;
-	ascii_table[(int)'J'] = (st_char_template *)&char_J;
-	ascii_table[(int)'K'] = (st_char_template *)&char_K;
-	ascii_table[(int)'L'] = (st_char_template *)&char_L;
-	ascii_table[(int)'M'] = (st_char_template *)&char_M;
-	ascii_table[(int)'N'] = (st_char_template *)&char_N;
-	ascii_table[(int)'O'] = (st_char_template *)&char_O;
-	ascii_table[(int)'P'] = (st_char_template *)&char_P;
-	ascii_table[(int)'Q'] = (st_char_template *)&char_Q;
-	ascii_table[(int)'R'] = (st_char_template *)&char_R;
-	ascii_table[(int)'S'] = (st_char_template *)&char_S;
-	ascii_table[(int)'T'] = (st_char_template *)&char_T;
-	ascii_table[(int)'U'] = (st_char_template *)&char_U;
-	ascii_table[(int)'V'] = (st_char_template *)&char_V;
-	ascii_table[(int)'W'] = (st_char_template *)&char_W;
-	ascii_table[(int)'X'] = (st_char_template *)&char_X;
-	ascii_table[(int)'Y'] = (st_char_template *)&char_Y;
-	ascii_table[(int)'Z'] = (st_char_template *)&char_Z;
-
-	ascii_table[(int)'a'] = (st_char_template *)&char_A;
-	ascii_table[(int)'b'] = (st_char_template *)&char_B;
-	ascii_table[(int)'c'] = (st_char_template *)&char_C;
-	ascii_table[(int)'d'] = (st_char_template *)&char_D;
-	ascii_table[(int)'e'] = (st_char_template *)&char_E;
-	ascii_table[(int)'f'] = (st_char_template *)&char_F;
-	ascii_table[(int)'g'] = (st_char_template *)&char_G;
-	ascii_table[(int)'h'] = (st_char_template *)&char_H;
-	ascii_table[(int)'i'] = (st_char_template *)&char_I;
-	ascii_table[(int)'j'] = (st_char_template *)&char_J;
-	ascii_table[(int)'k'] = (st_char_template *)&char_K;
-	ascii_table[(int)'l'] = (st_char_template *)&char_L;
-	ascii_table[(int)'m'] = (st_char_template *)&char_M;
-	ascii_table[(int)'n'] = (st_char_template *)&char_N;
-	ascii_table[(int)'o'] = (st_char_template *)&char_O;
-	ascii_table[(int)'p'] = (st_char_template *)&char_P;
-	ascii_table[(int)'q'] = (st_char_template *)&char_Q;
-	ascii_table[(int)'r'] = (st_char_template *)&char_R;
-	ascii_table[(int)'s'] = (st_char_template *)&char_S;
-	ascii_table[(int)'t'] = (st_char_template *)&char_T;
-	ascii_table[(int)'u'] = (st_char_template *)&char_U;
-	ascii_table[(int)'v'] = (st_char_template *)&char_V;
-	ascii_table[(int)'w'] = (st_char_template *)&char_W;
-	ascii_table[(int)'x'] = (st_char_template *)&char_X;
-	ascii_table[(int)'y'] = (st_char_template *)&char_Y;
-	ascii_table[(int)'z'] = (st_char_template *)&char_Z;
-
-	ascii_table[(int)'0'] = (st_char_template *)&char_0;
-	ascii_table[(int)'1'] = (st_char_template *)&char_1;
-	ascii_table[(int)'2'] = (st_char_template *)&char_2;
-	ascii_table[(int)'3'] = (st_char_template *)&char_3;
-	ascii_table[(int)'4'] = (st_char_template *)&char_4;
-	ascii_table[(int)'5'] = (st_char_template *)&char_5;
-	ascii_table[(int)'6'] = (st_char_template *)&char_6;
-	ascii_table[(int)'7'] = (st_char_template *)&char_7;
-	ascii_table[(int)'8'] = (st_char_template *)&char_8;
-	ascii_table[(int)'9'] = (st_char_template *)&char_9;
-
-	ascii_table[(int)' '] = (st_char_template *)&char_space;
-	ascii_table[(int)'?'] = (st_char_template *)&char_qmark;
-	ascii_table[(int)'!'] = (st_char_template *)&char_exmark;
-	ascii_table[(int)'+'] = (st_char_template *)&char_plus;
-	ascii_table[(int)'-'] = (st_char_template *)&char_minus;
-	ascii_table[(int)'*'] = (st_char_template *)&char_star;
-	ascii_table[(int)'='] = (st_char_template *)&char_equals;
-	ascii_table[(int)'.'] = (st_char_template *)&char_dot;
-	ascii_table[(int)','] = (st_char_template *)&char_comma;
-	ascii_table[(int)'('] = (st_char_template *)&char_lrbracket;
-	ascii_table[(int)')'] = (st_char_template *)&char_rrbracket;
-	ascii_table[(int)'{'] = (st_char_template *)&char_lcbracket;
-	ascii_table[(int)'}'] = (st_char_template *)&char_rcbracket;
-	ascii_table[(int)'['] = (st_char_template *)&char_lsbracket;
-	ascii_table[(int)']'] = (st_char_template *)&char_rsbracket;
-	ascii_table[(int)'$'] = (st_char_template *)&char_dollar;
-	ascii_table[(int)'#'] = (st_char_template *)&char_hash;
-	ascii_table[(int)'/'] = (st_char_template *)&char_fslash;
-	ascii_table[(int)'\\'] = (st_char_template *)&char_bslash;
-	ascii_table[(int)'>'] = (st_char_template *)&char_greater;
-	ascii_table[(int)'<'] = (st_char_template *)&char_less;
-	ascii_table[(int)'_'] = (st_char_template *)&char_underscore;
-	ascii_table[(int)'|'] = (st_char_template *)&char_bar;
-	ascii_table[(int)'\''] = (st_char_template *)&char_squote;
-	ascii_table[(int)'"'] = (st_char_template *)&char_dquote;
-	ascii_table[(int)'`'] = (st_char_template *)&char_bquote;
-	ascii_table[(int)':'] = (st_char_template *)&char_colon;
-	ascii_table[(int)';'] = (st_char_template *)&char_semicolon;
-	ascii_table[(int)'@'] = (st_char_template *)&char_at;
-	ascii_table[(int)'^'] = (st_char_template *)&char_hat;
-	ascii_table[(int)'~'] = (st_char_template *)&char_tilda;
-	ascii_table[(int)'&'] = (st_char_template *)&char_ampersand;
-	ascii_table[(int)'%'] = (st_char_template *)&char_percent;
-
-	// Adjust data values to have origin in centre , not top left. I'm
-	// too lazy to adjust all that data itself.
-	for(i=32;i < 256;++i)
+
+	atexit(schedReport);
+	atexit(drawReport);
+	atexit(collideReport);
+	schedInit();
+
+	for(refresh_cnt=0;;)
 	{
-		// A & a , B & b etc share the same struct so don't do this
-		// operation twice on them
-		if (ascii_table[i] && (i < 'a' || i > 'z'))
-		{
-			for(j=0;j < ascii_table[i]->cnt;++j)
-			{
-				ascii_table[i]->data[j].x -= CHAR_HALF;
-				ascii_table[i]->data[j].y -= CHAR_HALF;
-			}
-		}
-	}
+		phaseCheckSignal();
 
-	// Game object creation
-	objects[0] = player = new cl_player;
-	objects[1] = ball = new cl_ball;
-
-	for(i=0,j=2;i < MAX_NUGGETS;++i,++j) objects[j] = new cl_nugget;
-	for(i=0;i < MAX_BOULDERS;++i,++j)    objects[j] = new cl_boulder;
-	for(i=0;i < MAX_SPOOKYS;++i,++j)     objects[j] = new cl_spooky;
-	for(i=0;i < MAX_SPIKYS;++i,++j)      objects[j] = new cl_spiky;
-	for(i=0;i < MAX_GRUBBLES;++i,++j)    objects[j] = new cl_grubble;
-	for(i=0;i < MAX_WURMALS;++i,++j)     objects[j] = new cl_wurmal;
-
-	// Stones belong in their own list since they do nothing and don't
-	// interact with any other objects
-	for(i=0;i < MAX_STONES;++i) stones[i] = new cl_stone;
-
-	attract_enemy[0] = new cl_spooky;
-	attract_enemy[1] = new cl_grubble;
-	attract_enemy[2] = new cl_wurmal;
-	attract_enemy[3] = new cl_spiky;
-
-	// Text object creation
-	text_digger = new cl_text(cl_text::TXT_DIGGER);
-	text_s_to_start = new cl_text(cl_text::TXT_S_TO_START);
-	text_copyright = new cl_text(cl_text::TXT_COPYRIGHT);
-	text_level_start = new cl_text(cl_text::TXT_LEVEL_START);
-	text_ready = new cl_text(cl_text::TXT_READY);
-	text_paused = new cl_text(cl_text::TXT_PAUSED);
-	text_game_over = new cl_text(cl_text::TXT_GAME_OVER);
-	text_invisibility_powerup = new cl_text(cl_text::TXT_INVISIBILITY_POWERUP);
-	text_superball_powerup = new cl_text(cl_text::TXT_SUPERBALL_POWERUP);
-	text_freeze_powerup = new cl_text(cl_text::TXT_FREEZE_POWERUP);
-	text_new_high_score = new cl_text(cl_text::TXT_NEW_HIGH_SCORE);
-	text_bonus_life = new cl_text(cl_text::TXT_BONUS_LIFE);
-	text_got_spiky = new cl_text(cl_text::TXT_GOT_SPIKY);
-
-	for(i=0;i < NUM_BONUS_SCORES;++i)
-		text_bonus_score[i] = new cl_text(cl_text::TXT_BONUS_SCORE);
-
-	// Miscellanious
-	high_score = 10000;
-	done_high_score = false;
-	resetGameGlobals();
-
-	setGameStage(GAME_STAGE_ATTRACT_PLAY);
-}
+		start = getMonoTime();
+		processXEvents();
+		phaseAdd(PHASE_X_EVENTS,start);
 
+		// Run however many ticks are due and only draw the last one
+		if ((ticks = schedTicksDue()))
+		{
+			for(i=1;i <= ticks;++i)
+			{
+				do_draw = (i == ticks && !refresh_cnt);
+				if (do_draw)
+				{
+					if (use_shm) fbClear();
+					else if (!use_db) XClearWindow(display,win);
+				}
 
+				replayTick();
+				screen = runGameStage();
+				inputTick();
+				start = getMonoTime();
+				drawScreen(screen);
+				if (do_draw) phaseAdd(PHASE_DRAW,start);
 
+				if (!game->paused) ++game->game_stage_cnt;
+			}
 
-/*** Reset some stuff not done in initLevel() ***/
-void resetGameGlobals()
-{
-	setScore(0);
-	setLives(3);
-	paused = false;
-	done_high_score = false;
-	bonus_life_score = BONUS_LIFE_INC;
+			if (!refresh_cnt)
+			{
+				if (use_shm)
+				{
+					start = getMonoTime();
+					fbPresent();
+					phaseAdd(PHASE_SWAP_BUFFERS,start);
+				}
+				else if (use_db)
+				{
+					start = getMonoTime();
+					XdbeSwapBuffers(display,&swapinfo,1);
+					phaseAdd(PHASE_SWAP_BUFFERS,start);
+				}
+				start = getMonoTime();
+				XFlush(display);
+				phaseAdd(PHASE_X_FLUSH,start);
+			}
+			refresh_cnt = (refresh_cnt + 1) % win_refresh;
+		}
+		schedWait();
+	}
 }
 
 
-////////////////////////////////// RUNTIME ///////////////////////////////////
 
 
-/*** Get the events and draw the points ***/
-void mainloop()
+/*** Run the game with no X and no delay for the given number of ticks. The 
+     screen is still "drawn" because some of the objects update their state
+     in draw() but do_draw is false so nothing goes to the X primitives ***/
+void headlessloop()
 {
-	u_int tm1;
-	u_int tm2;
-	int diff;
+	double secs;
+	uint64_t start;
 	int i;
 
-	for(refresh_cnt=0;;refresh_cnt = (refresh_cnt + 1) % win_refresh)
-	{
-		tm1 = getTime();
-
-		if (!refresh_cnt && !use_db)
-			XClearWindow(display,win);
-		processXEvents();
+	do_draw = false;
+	atexit(collideReport);
+	start = getMonoTime();
 
-		// Switch on game stages 
-		switch(game_stage)
-		{
-		case GAME_STAGE_ATTRACT_PLAY:
-			if (game_stage_cnt < 0)
-			{
-				drawAsciiTable();
-				goto SKIP;
-			}
-			else if (game_stage_cnt == 1000)
-				setGameStage(GAME_STAGE_ATTRACT_ENEMIES);
-			else
-				run();
-			break;
+	for(i=0;i < headless_ticks;++i)
+	{
+		phaseCheckSignal();
+		replayTick();
+		gameTick();
+		inputTick();
+	}
 
-		case GAME_STAGE_ATTRACT_ENEMIES:
-			if (game_stage_cnt == 300)
-				setGameStage(GAME_STAGE_ATTRACT_KEYS);
-			else
-			{
-				for(i=0;i < NUM_ATTRACT_ENEMIES;++i)
-					attract_enemy[i]->attractRun();
-				drawEnemyScreen();
-			}
-			goto SKIP;
-
-		case GAME_STAGE_ATTRACT_KEYS:
-			if (game_stage_cnt == 200)
-				setGameStage(GAME_STAGE_ATTRACT_PLAY);
-			else
-				drawKeysScreen();
-			goto SKIP;
-
-		case GAME_STAGE_LEVEL_START:
-			if (game_stage_cnt == 50)
-				setGameStage(GAME_STAGE_READY);
-			break;
+	secs = (double)(getMonoTime() - start) / 1e9;
 
-		case GAME_STAGE_READY:
-			if (game_stage_cnt == 50)
-				setGameStage(GAME_STAGE_PLAY);
-			break;
+	printf("Headless: %d ticks in %.3f secs = %.0f ticks/sec, seed %llu\n",
+		headless_ticks,secs,secs > 0 ? headless_ticks / secs : 0,
+		(unsigned long long)game->rand_seed);
+	if (obj_run_cnt)
+	{
+		printf("Object run: %.1f nsecs/object, %s dispatch\n",
+			(double)obj_run_nsecs / obj_run_cnt,
+			virtual_dispatch ? "virtual" : "static");
+	}
+}
 
-		case GAME_STAGE_PLAY:
-			if (!paused) run();
-			break;
 
-		case GAME_STAGE_LEVEL_COMPLETE:
-			if (game_stage_cnt == 150)
-			{
-				++level;
-				setGroundColour();
-				setGameStage(GAME_STAGE_LEVEL_START);
-			}
-			else ground_colour = (game_stage_cnt * 2) % COL_GREEN2;
-			break;
-				
-		case GAME_STAGE_PLAYER_DIED:
-			if (game_stage_cnt == 10)
-				setGameStage(GAME_STAGE_READY);
-			break;
 
-		case GAME_STAGE_GAME_OVER:
-			if (game_stage_cnt == 250)
-			{
-				resetGameGlobals();
-				setGameStage(GAME_STAGE_ATTRACT_PLAY);
-			}
-			break;
 
-		default:
-			assert(0);
-		}
-		drawGameScreen();
+/*** Run a game per thread, each with its own seed, then print how they got
+     on and the total ticks per second ***/
+void threadedloop()
+{
+	vector<thread> threads;
+	vector<int> result(num_threads * 2);
+	double secs;
+	uint64_t start;
+	int i;
 
-		SKIP:
-		if (!paused) ++game_stage_cnt;
+	start = getMonoTime();
+	for(i=0;i < num_threads;++i)
+		threads.push_back(thread(threadGame,seed + i,&result[i * 2]));
+	for(auto &thr: threads) thr.join();
 
-		if (!refresh_cnt)
-		{
-			if (use_db) XdbeSwapBuffers(display,&swapinfo,1);
-			XFlush(display);
-		}
+	secs = (double)(getMonoTime() - start) / 1e9;
 
-		// Timing delay code taken from final_gun.
-		if ((tm2 = getTime()) > tm1)
-		{
-			diff = (int)(tm2 - tm1);
-			if (diff < MAINLOOP_DELAY)
-				usleep(MAINLOOP_DELAY - diff);
-		}
-		else usleep(MAINLOOP_DELAY);
+	for(i=0;i < num_threads;++i)
+	{
+		printf("Thread %d: seed %llu, score %d, level %d\n",
+			i,(unsigned long long)(seed + i),
+			result[i * 2],result[i * 2 + 1]);
 	}
+	printf("Headless: %d threads x %d ticks in %.3f secs = %.0f ticks/sec\n",
+		num_threads,headless_ticks,secs,
+		secs > 0 ? (double)num_threads * headless_ticks / secs : 0);
 }
 
 
 
 
-/*** Get the current time down to the microsecond. Value wraps once every
-     1000 seconds ***/
-u_int getTime()
+/*** Thread body. Result is the final score and level. ***/
+void threadGame(uint64_t game_seed, int *result)
 {
-	timeval tv;
-	gettimeofday(&tv,0);
-	return (u_int)(tv.tv_sec % 1000) * 1000000 + tv.tv_usec;
+	do_draw = false;
+	newGame(game_seed);
+	for(int i=0;i < headless_ticks;++i) gameTick();
+
+	result[0] = game->score;
+	result[1] = game->level;
+	freeGame(game);
 }
 
 
@@ -743,98 +711,29 @@ void processXEvents()
 			break;
 
 		case UnmapNotify:
-			if (game_stage == GAME_STAGE_PLAY)
-			{
-				// Auto pause if window unmapped
-				paused = true;
-				text_paused->reset();
-			}
+			if (replaying()) break;
+			recordInput(INPUT_UNMAP,0);
+			windowUnmapped();
 			break;
 
 		case KeyRelease:
-			if (game_stage == GAME_STAGE_PLAY)
-			{
-				XLookupString(&event.xkey,&key,1,&ksym,NULL);
-
-				switch(ksym)
-				{
-				case XK_Left:
-				case XK_Right:
-				case XK_Up:
-				case XK_Down:
-					player->stop(ksym);
-				}
-			}
+			if (replaying()) break;
+			XLookupString(&event.xkey,&key,1,&ksym,NULL);
+			recordInput(INPUT_KEY_RELEASE,ksym);
+			keyRelease(ksym);
 			break;
 
 		case KeyPress:
 			XLookupString(&event.xkey,&key,1,&ksym,NULL);
-			switch(ksym)
-			{
-#ifdef SOUND
-			case XK_v:
-			case XK_V:
-				do_sound = !do_sound;
-				break;
-#endif
-
-			case XK_p:
-			case XK_P:
-				if (game_stage == GAME_STAGE_PLAY)
-				{
-					if (paused)
-					{
-						paused = false;
-						break;
-					}
-					paused = true;
-					text_paused->reset();
-				}
-				break;
-
-			case XK_s:
-			case XK_S:
-				if (IN_ATTRACT_MODE())
-				{
-					level = 1;
-					resetGameGlobals();
-					setGameStage(GAME_STAGE_LEVEL_START);
-					// Echo switched off when player
-					// activated
-					echoOn();
-					playFGSound(SND_START);
-				}
-				break;
 
-			case XK_Left:
-			case XK_Right:
-			case XK_Up:
-			case XK_Down:
-				if (game_stage == GAME_STAGE_PLAY)
-					player->move(ksym);
-				break;
-
-			case XK_space:
-				if (game_stage == GAME_STAGE_PLAY)
-					player->throwBall();
-				break;
-
-			case XK_question:
-				if (IN_ATTRACT_MODE()) game_stage_cnt = -200;
-				break;
-
-			case XK_plus:
-				level = IN_ATTRACT_MODE() ? 1 : level+1;
-				resetGameGlobals();
-				setGameStage(GAME_STAGE_LEVEL_START);
-				break;
-
-			case XK_Escape:
-				if (IN_ATTRACT_MODE()) exit(0);
-				resetGameGlobals();
-				setGameStage(GAME_STAGE_ATTRACT_PLAY);
+			// Only escape gets through during a replay
+			if (replaying())
+			{
+				if (ksym == XK_Escape) exit(0);
 				break;
 			}
+			recordInput(INPUT_KEY_PRESS,ksym);
+			keyPress(ksym);
 			break;
 
 		default:
@@ -846,163 +745,123 @@ void processXEvents()
 
 
 
-/*** Run everything and check for collisions ***/
-void run()
+/*** Keys come here from the X server or a replay ***/
+void keyPress(KeySym ksym)
 {
-	double dist;
-	int o;
-	int p;
-
-	// If player has died flick ground colour and reset to appropriate 
-	// game stage
-	if (player->stage == STAGE_EXPLODE)
+	switch(ksym)
 	{
-		if (player->stage_cnt < 10)
-			ground_colour = random() % NUM_FULL_COLOURS;
-		else if (player->stage_cnt == 100)
+#ifdef SOUND
+	case XK_v:
+	case XK_V:
+		do_sound = !do_sound;
+		break;
+#endif
+
+	case XK_p:
+	case XK_P:
+		if (game->game_stage == GAME_STAGE_PLAY)
 		{
-			setGameStage(IN_ATTRACT_MODE() ? 
-			             GAME_STAGE_ATTRACT_ENEMIES : GAME_STAGE_PLAYER_DIED);
-			return;
+			if (game->paused)
+			{
+				game->paused = false;
+				break;
+			}
+			game->paused = true;
+			game->text_paused->reset();
 		}
-		else setGroundColour(); 
-	}
+		break;
 
-	// Run objects
-	for(auto obj: objects) if (obj->stage != STAGE_INACTIVE) obj->run();
+	case XK_s:
+	case XK_S:
+		if (IN_ATTRACT_MODE()) startGame();
+		break;
 
-	// Check for collions in a seperate loop so all objects have already
-	// run.
-	for(o=0;o < MAX_OBJECTS-1;++o)
-	{
-		cl_object *obj1 = objects[o];
-		switch(obj1->stage)
-		{
-		case STAGE_RUN:
-		case STAGE_WOBBLE:
-		case STAGE_FALL:
-		case STAGE_BEING_EATEN:
-			break;
+	case XK_Left:
+	case XK_Right:
+	case XK_Up:
+	case XK_Down:
+		if (game->game_stage == GAME_STAGE_PLAY) game->player->move(ksym);
+		break;
 
-		default:
-			continue;
-		}
+	case XK_space:
+		if (game->game_stage == GAME_STAGE_PLAY) game->player->throwBall();
+		break;
 
-		for(p=o+1;p < MAX_OBJECTS;++p)
-		{
-			cl_object *obj2 = objects[p];
-			switch(obj2->stage)
-			{
-			case STAGE_RUN:
-			case STAGE_WOBBLE:
-			case STAGE_FALL:
-			case STAGE_BEING_EATEN:
-				// Wurmal is special case - must always use its
-				// overloaded version of function
-				if (obj2->type == TYPE_WURMAL)
-					dist = obj2->overlapDist(obj1);
-				else
-					dist = obj1->overlapDist(obj2);
-
-				if (dist)
-				{
-					obj1->haveCollided(obj2,dist);
-					obj2->haveCollided(obj1,dist);
-				}
-				break;
+	case XK_question:
+		if (IN_ATTRACT_MODE()) game->game_stage_cnt = -200;
+		break;
 
-			default:
-				break;
-			}
-		}
-	}
+	case XK_plus:
+		game->level = IN_ATTRACT_MODE() ? 1 : game->level+1;
+		resetGameGlobals();
+		setGameStage(GAME_STAGE_LEVEL_START);
+		break;
 
-	duringLevel();
+	case XK_Escape:
+		if (IN_ATTRACT_MODE()) exit(0);
+		resetGameGlobals();
+		setGameStage(GAME_STAGE_ATTRACT_PLAY);
+		break;
+	}
 }
 
 
 
 
-/*** Timed events during a level. I use game_stage_cnt because its reset to 
-     zero each time player dies. ***/
-void duringLevel()
+void keyRelease(KeySym ksym)
 {
-	if (!game_stage_cnt) return;
+	if (game->game_stage != GAME_STAGE_PLAY) return;
 
-	// Check for player completing level.
-	if (game_stage == GAME_STAGE_PLAY && !nugget_cnt)
+	switch(ksym)
 	{
-		setGameStage(GAME_STAGE_LEVEL_COMPLETE);
-		playFGSound(SND_LEVEL_COMPLETE);
-		return;
+	case XK_Left:
+	case XK_Right:
+	case XK_Up:
+	case XK_Down:
+		game->player->stop(ksym);
 	}
+}
 
-	// Keep creating spookys at regular intervals
-	if (game_stage_cnt == first_spooky_cnt || 
-	    !(game_stage_cnt % spooky_create_mod)) 
-		activateObjects(TYPE_SPOOKY,1);
 
-	switch(level)
-	{
-	case 1:
-		if (game_stage_cnt == 500 || game_stage_cnt == 1000) 
-			activateObjects(TYPE_GRUBBLE,1);
-		break;
 
-	case 2:
-		if (game_stage_cnt == 400 || 
-		    game_stage_cnt == 800 ||
-		    game_stage_cnt == 1200) activateObjects(TYPE_GRUBBLE,1);
-		break;
 
-	case 3:
-		if (game_stage_cnt == 1)
-			activateObjects(TYPE_WURMAL,1 - wurmals_killed);
-		else
-		if (!(game_stage_cnt % 300)) activateObjects(TYPE_GRUBBLE,1);
-		break;
+/*** Auto pause if window unmapped ***/
+void windowUnmapped()
+{
+	if (game->game_stage == GAME_STAGE_PLAY)
+	{
+		game->paused = true;
+		game->text_paused->reset();
+	}
+}
 
-	case 4:
-		if (game_stage_cnt == 1)
-			activateObjects(TYPE_WURMAL,1 - wurmals_killed);
-		else
-		if (!(game_stage_cnt % 300)) activateObjects(TYPE_GRUBBLE,1);
 
-		if (game_stage_cnt > 500 && !(random() % 400))
-			activateObjectsTotal(TYPE_SPIKY,1);
-		break;
 
-	case 5:
-	case 6:
-		if (game_stage_cnt == 1)
-			activateObjects(TYPE_WURMAL,1 - wurmals_killed);
-		else
-		if (!(game_stage_cnt % 250)) activateObjects(TYPE_GRUBBLE,1);
 
-		if (game_stage_cnt > 500 && !(random() % 300))
-			activateObjectsTotal(TYPE_SPIKY,1);
-		break;
+/*** Feed in any recorded input due on this tick ***/
+void replayTick()
+{
+	en_input type;
+	KeySym ksym;
 
-	case 7:
-	case 8:
-		if (game_stage_cnt == 1)
-			activateObjects(TYPE_WURMAL,2 - wurmals_killed);
-		else
-		if (!(game_stage_cnt % 200)) activateObjects(TYPE_GRUBBLE,1);
+	while(replayInput(type,ksym))
+	{
+		switch(type)
+		{
+		case INPUT_KEY_PRESS:
+			keyPress(ksym);
+			break;
 
-		if (game_stage_cnt > 500 && !(random() % 300))
-			activateObjects(TYPE_SPIKY,1);
-		break;
+		case INPUT_KEY_RELEASE:
+			keyRelease(ksym);
+			break;
 
-	default:
-		if (game_stage_cnt == 1)
-			activateObjects(TYPE_WURMAL,2 - wurmals_killed);
-		else
-		if (!(game_stage_cnt % grubble_create_mod))
-			activateObjects(TYPE_GRUBBLE,1);
+		case INPUT_UNMAP:
+			windowUnmapped();
+			break;
 
-		if (game_stage_cnt > 400 && !(random() % 200))
-			activateObjects(TYPE_SPIKY,1);
-		break;
+		default:
+			assert(0);
+		}
 	}
 }
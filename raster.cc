@@ -0,0 +1,412 @@
+// Client side rasteriser for the few shapes the game uses. Everything comes
+// down to filling horizontal spans of 32 bit pixels which is done with SSE2
+// or AVX2 depending on what the CPU has.
+
+#include "globals.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RASTER_X86
+#include <immintrin.h>
+#endif
+
+#define MAX_POLY_CROSSINGS MAX_TMP_POINTS
+
+// Spans shorter than this aren't worth setting up the vector stores for
+#define MIN_VECTOR_SPAN 8
+
+// Buffer being drawn into
+static uint32_t *rs_pixels;
+static int rs_width;
+static int rs_height;
+static int rs_stride;
+
+static void spanScalar(uint32_t *p, int cnt, uint32_t pixel);
+#ifdef RASTER_X86
+static void spanSSE2(uint32_t *p, int cnt, uint32_t pixel);
+static void spanAVX2(uint32_t *p, int cnt, uint32_t pixel);
+#endif
+
+static struct st_span_kernel
+{
+	const char *name;
+	void (*func)(uint32_t *p, int cnt, uint32_t pixel);
+} span_kernel[] =
+{
+#ifdef RASTER_X86
+	{ "avx2",   spanAVX2 },
+	{ "sse2",   spanSSE2 },
+#endif
+	{ "scalar", spanScalar }
+};
+
+#define NUM_SPAN_KERNELS (int)(sizeof(span_kernel) / sizeof(st_span_kernel))
+
+static st_span_kernel *kernel = &span_kernel[NUM_SPAN_KERNELS - 1];
+
+static void rowSpan(int col, int y, double lo, double hi);
+static void span(uint32_t *row, int x1, int x2, uint32_t pixel);
+
+
+/*** Pick the fastest span fill the CPU supports ***/
+void rasterInit()
+{
+#ifdef RASTER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		rasterSetKernel("avx2");
+	else if (__builtin_cpu_supports("sse2"))
+		rasterSetKernel("sse2");
+	else
+#endif
+		rasterSetKernel("scalar");
+}
+
+
+
+
+/*** Force a particular span fill. Returns false if it doesn't exist ***/
+bool rasterSetKernel(const char *name)
+{
+	for(int i=0;i < NUM_SPAN_KERNELS;++i)
+	{
+		if (!strcasecmp(span_kernel[i].name,name))
+		{
+			kernel = &span_kernel[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
+const char *rasterKernelName()
+{
+	return kernel->name;
+}
+
+
+
+
+/*** Set the buffer to draw into. Stride is in pixels. ***/
+void rasterTarget(uint32_t *pixels, int width, int height, int stride)
+{
+	rs_pixels = pixels;
+	rs_width = width;
+	rs_height = height;
+	rs_stride = stride;
+}
+
+
+//////////////////////////////// PRIMITIVES ///////////////////////////////////
+
+/*** Lines have round caps so they're a capsule shape. Each row of a capsule
+     is a single span made up of the end caps and the rectangle in between.
+     The rectangle's corners and edge slopes are worked out once up front. ***/
+void rasterLine(int col, int width, int x1, int y1, int x2, int y2)
+{
+	double px[4];
+	double py[4];
+	double slope[4];
+	double r = (double)width / 2;
+	double r2 = r * r;
+	double fx1 = x1 + 0.5;
+	double fy1 = y1 + 0.5;
+	double fx2 = x2 + 0.5;
+	double fy2 = y2 + 0.5;
+	double len;
+	double nx;
+	double ny;
+	double yc;
+	double dy;
+	double dx;
+	double lo;
+	double hi;
+	int ymin;
+	int ymax;
+	int y;
+	int i;
+	int j;
+
+	ymin = (int)floor(min(y1,y2) - r);
+	ymax = (int)ceil(max(y1,y2) + r);
+	if (ymin < 0) ymin = 0;
+	if (ymax >= rs_height) ymax = rs_height - 1;
+	if (ymin > ymax) return;
+
+	// Corners of the rectangle either side of the line
+	if ((len = hypot(fx2 - fx1,fy2 - fy1)))
+	{
+		nx = -(fy2 - fy1) / len * r;
+		ny = (fx2 - fx1) / len * r;
+		px[0] = fx1 + nx;  py[0] = fy1 + ny;
+		px[1] = fx2 + nx;  py[1] = fy2 + ny;
+		px[2] = fx2 - nx;  py[2] = fy2 - ny;
+		px[3] = fx1 - nx;  py[3] = fy1 - ny;
+		for(i=0,j=3;i < 4;j=i++)
+		{
+			slope[i] = (py[j] != py[i]) ? 
+			           (px[j] - px[i]) / (py[j] - py[i]) : 0;
+		}
+	}
+
+	for(y=ymin;y <= ymax;++y)
+	{
+		yc = y + 0.5;
+		lo = HUGE_VAL;
+		hi = -HUGE_VAL;
+
+		// End caps
+		dy = yc - fy1;
+		if (dy * dy <= r2)
+		{
+			dx = sqrt(r2 - dy * dy);
+			lo = fx1 - dx;
+			hi = fx1 + dx;
+		}
+		dy = yc - fy2;
+		if (dy * dy <= r2)
+		{
+			dx = sqrt(r2 - dy * dy);
+			lo = min(lo,fx2 - dx);
+			hi = max(hi,fx2 + dx);
+		}
+
+		// Where the row crosses the rectangle edges
+		if (len)
+		{
+			for(i=0,j=3;i < 4;j=i++)
+			{
+				if ((py[i] <= yc && py[j] > yc) || 
+				    (py[j] <= yc && py[i] > yc))
+				{
+					dx = px[i] + (yc - py[i]) * slope[i];
+					lo = min(lo,dx);
+					hi = max(hi,dx);
+				}
+			}
+		}
+		rowSpan(col,y,lo,hi);
+	}
+}
+
+
+
+
+void rasterSegments(int col, int width, XSegment *seg, int cnt)
+{
+	for(int i=0;i < cnt;++i)
+		rasterLine(col,width,seg[i].x1,seg[i].y1,seg[i].x2,seg[i].y2);
+}
+
+
+
+
+void rasterFillRectangle(int col, int x, int y, int w, int h)
+{
+	int ymax = y + h;
+
+	if (y < 0) y = 0;
+	if (ymax > rs_height) ymax = rs_height;
+
+	for(;y < ymax;++y)
+		span(rs_pixels + y * rs_stride,x,x + w - 1,xcol[col].pixel);
+}
+
+
+
+
+void rasterDrawRectangle(int col, int width, int x, int y, int w, int h)
+{
+	rasterLine(col,width,x,y,x + w,y);
+	rasterLine(col,width,x + w,y,x + w,y + h);
+	rasterLine(col,width,x + w,y + h,x,y + h);
+	rasterLine(col,width,x,y + h,x,y);
+}
+
+
+
+
+/*** Uses the even-odd rule same as the X default ***/
+void rasterFillPolygon(int col, XPoint *points, int num_points)
+{
+	double cross[MAX_POLY_CROSSINGS];
+	double yc;
+	int ymin;
+	int ymax;
+	int cnt;
+	int y;
+	int i;
+	int j;
+
+	assert(num_points <= MAX_POLY_CROSSINGS);
+
+	ymin = ymax = points[0].y;
+	for(i=1;i < num_points;++i)
+	{
+		if (points[i].y < ymin) ymin = points[i].y;
+		else
+		if (points[i].y > ymax) ymax = points[i].y;
+	}
+	if (ymin < 0) ymin = 0;
+	if (ymax >= rs_height) ymax = rs_height - 1;
+
+	for(y=ymin;y <= ymax;++y)
+	{
+		yc = y + 0.5;
+		cnt = 0;
+		for(i=0,j=num_points-1;i < num_points;j=i++)
+		{
+			if ((points[i].y <= yc && points[j].y > yc) ||
+			    (points[j].y <= yc && points[i].y > yc))
+			{
+				cross[cnt++] = points[i].x +
+				               (yc - points[i].y) *
+				               (points[j].x - points[i].x) /
+				               (points[j].y - points[i].y);
+			}
+		}
+
+		// Rocks are nearly always convex so usually just 2
+		if (cnt == 2)
+		{
+			if (cross[0] > cross[1]) swap(cross[0],cross[1]);
+		}
+		else sort(cross,cross + cnt);
+
+		for(i=0;i < cnt - 1;i+=2)
+			rowSpan(col,y,cross[i],cross[i+1]);
+	}
+}
+
+
+
+
+void rasterDrawPolygon(int col, int width, XPoint *points, int num_points)
+{
+	for(int i=0,j=num_points-1;i < num_points;j=i++)
+	{
+		rasterLine(
+			col,width,
+			points[j].x,points[j].y,points[i].x,points[i].y);
+	}
+}
+
+
+
+
+/*** Same arguments as XFillArc() and XDrawArc() for a full circle. If width
+     is 0 the ellipse is filled. ***/
+void rasterDrawOrFillEllipse(int col, int width, int x, int y, int w, int h)
+{
+	double cx = x + (double)w / 2;
+	double cy = y + (double)h / 2;
+	double a = (double)w / 2;
+	double b = (double)h / 2;
+	double r = (double)width / 2;
+	double ia = a - r;
+	double ib = b - r;
+	double yc;
+	double dy;
+	double dx;
+	double idx;
+	int ymin;
+	int ymax;
+
+	if (width)
+	{
+		a += r;
+		b += r;
+	}
+	ymin = (int)floor(cy - b);
+	ymax = (int)ceil(cy + b);
+	if (ymin < 0) ymin = 0;
+	if (ymax >= rs_height) ymax = rs_height - 1;
+
+	for(y=ymin;y <= ymax;++y)
+	{
+		yc = y + 0.5;
+		if ((dy = fabs(yc - cy)) > b) continue;
+		dx = a * sqrt(1 - (dy * dy) / (b * b));
+
+		// For an outline cut out the inside
+		if (width && ia > 0 && ib > 0 && dy < ib)
+		{
+			idx = ia * sqrt(1 - (dy * dy) / (ib * ib));
+			rowSpan(col,y,cx - dx,cx - idx);
+			rowSpan(col,y,cx + idx,cx + dx);
+		}
+		else rowSpan(col,y,cx - dx,cx + dx);
+	}
+}
+
+
+
+
+/*** Fill the pixels on the row whose centres lie between lo and hi ***/
+void rowSpan(int col, int y, double lo, double hi)
+{
+	if (lo > hi) return;
+	span(
+		rs_pixels + y * rs_stride,
+		(int)ceil(lo - 0.5),(int)floor(hi - 0.5),xcol[col].pixel);
+}
+
+
+
+
+/*** Set the pixels from x1 to x2 inclusive clipped to the buffer ***/
+void span(uint32_t *row, int x1, int x2, uint32_t pixel)
+{
+	int cnt;
+
+	if (x1 < 0) x1 = 0;
+	if (x2 >= rs_width) x2 = rs_width - 1;
+	if ((cnt = x2 - x1 + 1) <= 0) return;
+
+	if (cnt < MIN_VECTOR_SPAN)
+		spanScalar(row + x1,cnt,pixel);
+	else
+		kernel->func(row + x1,cnt,pixel);
+}
+
+
+////////////////////////////////// KERNELS /////////////////////////////////////
+
+void spanScalar(uint32_t *p, int cnt, uint32_t pixel)
+{
+	for(;cnt;--cnt) *p++ = pixel;
+}
+
+
+#ifdef RASTER_X86
+
+/*** 4 pixels at a time. Unaligned stores cost next to nothing on anything
+     recent. Spans are always at least MIN_VECTOR_SPAN so the leftover pixels
+     are done by one more store overlapping the previous one. ***/
+__attribute__((target("sse2")))
+void spanSSE2(uint32_t *p, int cnt, uint32_t pixel)
+{
+	__m128i val = _mm_set1_epi32((int)pixel);
+	uint32_t *end = p + cnt - 4;
+
+	for(;p < end;p+=4) _mm_storeu_si128((__m128i *)p,val);
+	_mm_storeu_si128((__m128i *)end,val);
+}
+
+
+
+
+/*** As above but 8 pixels at a time ***/
+__attribute__((target("avx2")))
+void spanAVX2(uint32_t *p, int cnt, uint32_t pixel)
+{
+	__m256i val = _mm256_set1_epi32((int)pixel);
+	uint32_t *end = p + cnt - 8;
+
+	for(;p < end;p+=8) _mm256_storeu_si256((__m256i *)p,val);
+	_mm256_storeu_si256((__m256i *)end,val);
+}
+
+#endif
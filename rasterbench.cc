@@ -0,0 +1,392 @@
+// Micro benchmark for the raster.cc kernels. Draws the same sets of rock
+// polygons, filled circles and thick lines with each span kernel and with
+// the X server into a pixmap then prints the fill rate of each.
+// Build with "make rasterbench".
+
+#define MAINFILE
+#include "globals.h"
+
+#define NUM_SHAPES   2000
+#define BENCH_NSECS  500000000ULL
+#define BENCH_COL    1
+
+enum en_shape
+{
+	SHAPE_POLYGON,
+	SHAPE_CIRCLE,
+	SHAPE_LINE,
+
+	NUM_SHAPE_TYPES
+};
+
+static const char *shape_name[NUM_SHAPE_TYPES] =
+{
+	"Polygons",
+	"Circles",
+	"Lines"
+};
+
+static struct st_shape
+{
+	int num_points;
+	XPoint points[20];
+	int x;
+	int y;
+	int diam;
+	int width;
+
+	// Bounding box in pixels for counting
+	int min_x;
+	int min_y;
+	int max_x;
+	int max_y;
+} shapes[NUM_SHAPE_TYPES][NUM_SHAPES];
+
+static u_long shape_pixels[NUM_SHAPE_TYPES];
+static uint32_t *pixels;
+static int size;
+static char *disp;
+static bool use_x;
+
+static void parseCmdLine(int argc, char **argv);
+static void createShapes();
+static void setBoundingBox(st_shape *shp, int x1, int y1, int x2, int y2);
+static void countPixels();
+static void drawShape(en_shape type, st_shape *shp);
+static double benchSoftware(en_shape type);
+static double benchX(en_shape type, Pixmap pixmap, GC gc);
+
+
+int main(int argc, char **argv)
+{
+	const char *kernels[] = { "scalar", "sse2", "avx2" };
+	Pixmap pixmap = 0;
+	GC gc = 0;
+	double xrate[NUM_SHAPE_TYPES];
+	int screen;
+	int t;
+
+	parseCmdLine(argc,argv);
+
+	// Same as setScaling() without pulling in the rest of the game
+	x_scaling = y_scaling = avg_scaling = (double)size / SCR_SIZE;
+
+	pixels = (uint32_t *)calloc(size * size,sizeof(uint32_t));
+	assert(pixels);
+	rasterTarget(pixels,size,size,size);
+	xcol[BENCH_COL].pixel = 0xFFFFFF;
+
+	createShapes();
+	countPixels();
+
+	if (use_x)
+	{
+		if (!(display = XOpenDisplay(disp)))
+		{
+			printf("WARNING: Can't connect to %s, X server not tested.\n",
+				XDisplayName(disp));
+			use_x = false;
+		}
+		else
+		{
+			screen = DefaultScreen(display);
+			pixmap = XCreatePixmap(
+				display,RootWindow(display,screen),size,size,
+				DefaultDepth(display,screen));
+			gc = XCreateGC(display,pixmap,0,NULL);
+			XSetForeground(display,gc,WhitePixel(display,screen));
+		}
+	}
+
+	printf("Size %dx%d, %d shapes per set (Mpixels/sec)\n",
+		size,size,NUM_SHAPES);
+	printf("    %-10s %9s","SHAPE","PIX/SHAPE");
+	for(auto name: kernels) printf(" %9s",name);
+	if (use_x) printf(" %9s","X SERVER");
+	putchar('\n');
+
+	for(t=0;t < NUM_SHAPE_TYPES;++t)
+	{
+		if (use_x) xrate[t] = benchX((en_shape)t,pixmap,gc);
+
+		printf("    %-10s %9lu",
+			shape_name[t],shape_pixels[t] / NUM_SHAPES);
+		for(auto name: kernels)
+		{
+			if (rasterSetKernel(name))
+				printf(" %9.1f",benchSoftware((en_shape)t) / 1e6);
+			else
+				printf(" %9s","-");
+		}
+		if (use_x) printf(" %9.1f",xrate[t] / 1e6);
+		putchar('\n');
+	}
+
+	if (use_x)
+	{
+		XFreeGC(display,gc);
+		XFreePixmap(display,pixmap);
+		XCloseDisplay(display);
+	}
+	return 0;
+}
+
+
+
+
+void parseCmdLine(int argc, char **argv)
+{
+	int i;
+
+	size = SCR_SIZE;
+	disp = NULL;
+	use_x = true;
+
+	for(i=1;i < argc;++i)
+	{
+		if (!strcmp(argv[i],"-nox"))
+		{
+			use_x = false;
+			continue;
+		}
+		if (i == argc - 1) goto USAGE;
+
+		if (!strcmp(argv[i],"-size"))
+		{
+			if ((size = atoi(argv[++i])) < 1) goto USAGE;
+		}
+		else if (!strcmp(argv[i],"-disp")) disp = argv[++i];
+		else goto USAGE;
+	}
+	return;
+
+	USAGE:
+	printf("Usage: %s [-size <pixels>] [-disp <display>] [-nox]\n",argv[0]);
+	exit(1);
+}
+
+
+
+
+/*** Shapes are made in game co-ordinates the same way the game makes them
+     then scaled to the window size ***/
+void createShapes()
+{
+	st_shape *shp;
+	double ang;
+	double len;
+	int radius;
+	int i;
+	int j;
+
+	srandom(1);
+
+	for(i=0;i < NUM_SHAPES;++i)
+	{
+		// Rocks the size of nuggets and boulders. See cl_rock::activate()
+		shp = &shapes[SHAPE_POLYGON][i];
+		shp->x = random() % SCR_SIZE;
+		shp->y = random() % SCR_SIZE;
+		radius = (random() % 2) ? 15 : 30;
+		shp->num_points = 5 + random() % 15;
+		for(j=0;j < shp->num_points;++j)
+		{
+			ang = (double)j * 360 / shp->num_points;
+			len = (double)radius -
+			      ((double)(random() % radius) - (double)(radius / 2)) / 4;
+			shp->points[j].x = (short)((SIN(ang) * len + shp->x) * x_scaling);
+			shp->points[j].y = (short)((COS(ang) * len + shp->y) * y_scaling);
+		}
+		setBoundingBox(
+			shp,
+			(int)((shp->x - radius * 2) * x_scaling),
+			(int)((shp->y - radius * 2) * y_scaling),
+			(int)((shp->x + radius * 2) * x_scaling),
+			(int)((shp->y + radius * 2) * y_scaling));
+
+		// Explosion particles and eyes
+		shp = &shapes[SHAPE_CIRCLE][i];
+		shp->diam = (int)((5 + random() % 40) * avg_scaling);
+		shp->x = (int)(random() % SCR_SIZE * x_scaling) - shp->diam / 2;
+		shp->y = (int)(random() % SCR_SIZE * y_scaling) - shp->diam / 2;
+		setBoundingBox(
+			shp,
+			shp->x - 1,shp->y - 1,
+			shp->x + shp->diam + 1,shp->y + shp->diam + 1);
+
+		// Font strokes and spiky arms
+		shp = &shapes[SHAPE_LINE][i];
+		shp->width = (int)rint((2 + random() % 3) * avg_scaling);
+		if (shp->width < 1) shp->width = 1;
+		shp->x = random() % SCR_SIZE;
+		shp->y = random() % SCR_SIZE;
+		ang = random() % 360;
+		len = 5 + random() % 20;
+		shp->points[0].x = (short)(shp->x * x_scaling);
+		shp->points[0].y = (short)(shp->y * y_scaling);
+		shp->points[1].x = (short)((shp->x + SIN(ang) * len) * x_scaling);
+		shp->points[1].y = (short)((shp->y + COS(ang) * len) * y_scaling);
+		setBoundingBox(
+			shp,
+			min(shp->points[0].x,shp->points[1].x) - shp->width,
+			min(shp->points[0].y,shp->points[1].y) - shp->width,
+			max(shp->points[0].x,shp->points[1].x) + shp->width,
+			max(shp->points[0].y,shp->points[1].y) + shp->width);
+	}
+}
+
+
+
+
+/*** Clip to the buffer ***/
+void setBoundingBox(st_shape *shp, int x1, int y1, int x2, int y2)
+{
+	shp->min_x = max(x1,0);
+	shp->min_y = max(y1,0);
+	shp->max_x = min(x2,size - 1);
+	shp->max_y = min(y2,size - 1);
+}
+
+
+
+
+/*** Draw each shape onto the clear buffer and count what got set. Overlapping
+     shapes are counted once per shape so do them one at a time. ***/
+void countPixels()
+{
+	st_shape *shp;
+	uint32_t *p;
+	int t;
+	int i;
+	int x;
+	int y;
+
+	for(t=0;t < NUM_SHAPE_TYPES;++t)
+	{
+		shape_pixels[t] = 0;
+		for(i=0,shp=shapes[t];i < NUM_SHAPES;++i,++shp)
+		{
+			drawShape((en_shape)t,shp);
+
+			for(y=shp->min_y;y <= shp->max_y;++y)
+			{
+				p = pixels + y * size;
+				for(x=shp->min_x;x <= shp->max_x;++x)
+				{
+					if (p[x])
+					{
+						++shape_pixels[t];
+						p[x] = 0;
+					}
+				}
+			}
+		}
+	}
+}
+
+
+
+
+void drawShape(en_shape type, st_shape *shp)
+{
+	XSegment seg;
+
+	switch(type)
+	{
+	case SHAPE_POLYGON:
+		rasterFillPolygon(BENCH_COL,shp->points,shp->num_points);
+		break;
+
+	case SHAPE_CIRCLE:
+		rasterDrawOrFillEllipse(
+			BENCH_COL,0,shp->x,shp->y,shp->diam,shp->diam);
+		break;
+
+	case SHAPE_LINE:
+		seg.x1 = shp->points[0].x;
+		seg.y1 = shp->points[0].y;
+		seg.x2 = shp->points[1].x;
+		seg.y2 = shp->points[1].y;
+		rasterSegments(BENCH_COL,shp->width,&seg,1);
+		break;
+
+	default:
+		assert(0);
+	}
+}
+
+
+
+
+/*** Returns pixels per second ***/
+double benchSoftware(en_shape type)
+{
+	uint64_t start = getMonoTime();
+	uint64_t elapsed;
+	int passes = 0;
+
+	do
+	{
+		for(int i=0;i < NUM_SHAPES;++i) drawShape(type,&shapes[type][i]);
+		++passes;
+	} while((elapsed = getMonoTime() - start) < BENCH_NSECS);
+
+	return (double)shape_pixels[type] * passes / ((double)elapsed / 1e9);
+}
+
+
+
+
+/*** As above but with the X server. XSync() after each pass so we time
+     the server actually drawing and not just the requests being queued ***/
+double benchX(en_shape type, Pixmap pixmap, GC gc)
+{
+	XSegment seg;
+	st_shape *shp;
+	uint64_t start;
+	uint64_t elapsed;
+	int passes = 0;
+	int i;
+
+	start = getMonoTime();
+	do
+	{
+		for(i=0,shp=shapes[type];i < NUM_SHAPES;++i,++shp)
+		{
+			switch(type)
+			{
+			case SHAPE_POLYGON:
+				XFillPolygon(
+					display,pixmap,gc,
+					shp->points,shp->num_points,
+					Nonconvex,CoordModeOrigin);
+				break;
+
+			case SHAPE_CIRCLE:
+				XFillArc(
+					display,pixmap,gc,
+					shp->x,shp->y,shp->diam,shp->diam,
+					0,FULL_CIRCLE);
+				break;
+
+			case SHAPE_LINE:
+				seg.x1 = shp->points[0].x;
+				seg.y1 = shp->points[0].y;
+				seg.x2 = shp->points[1].x;
+				seg.y2 = shp->points[1].y;
+				XSetLineAttributes(
+					display,gc,shp->width,
+					LineSolid,CapRound,JoinRound);
+				XDrawSegments(display,pixmap,gc,&seg,1);
+				break;
+
+			default:
+				assert(0);
+			}
+		}
+		XSync(display,False);
+		++passes;
+	} while((elapsed = getMonoTime() - start) < BENCH_NSECS);
+
+	return (double)shape_pixels[type] * passes / ((double)elapsed / 1e9);
+}
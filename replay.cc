@@ -0,0 +1,228 @@
+// Recording and replaying the player's input. A recording is the random seed
+// followed by every key the game acts on tagged with the tick it came in
+// before. Since everything else comes off the seed, feeding the keys back in
+// on the same ticks plays the same game again without anyone at the keyboard.
+//
+// File layout, all little endian:
+//
+//     "DGRC" <version:1> <seed:8>
+//     then per input: <ticks since last input:varint> <type:1> <keysym:2>
+//
+// The last input is INPUT_END on the tick recording stopped. If the game was
+// killed before that could be written the file just ends after the last
+// input which is flushed as it goes, so the replay stops there instead.
+
+#include "globals.h"
+
+#include <errno.h>
+
+#define REC_MAGIC   "DGRC"
+#define REC_VERSION 1
+
+struct st_input
+{
+	u_long tick;
+	en_input type;
+	KeySym ksym;
+};
+
+static FILE *rec_fp;
+static u_long rec_last_tick;
+
+static vector<st_input> replay_inputs;
+static size_t replay_pos;
+
+// Ticks run since the start
+static u_long input_tick;
+
+static void recordEnd();
+static void putVarint(u_long val);
+static bool getVarint(FILE *fp, u_long &val);
+
+
+/*** Open the file and write the header. Exits if it can't be created. ***/
+void recordStart(const char *filename, uint64_t seed)
+{
+	int i;
+
+	if (!(rec_fp = fopen(filename,"wb")))
+	{
+		printf("ERROR: Can't create recording file '%s': %s\n",
+			filename,strerror(errno));
+		exit(1);
+	}
+	fputs(REC_MAGIC,rec_fp);
+	fputc(REC_VERSION,rec_fp);
+	for(i=0;i < 8;++i) fputc((int)(seed >> (i * 8)) & 0xFF,rec_fp);
+
+	rec_last_tick = 0;
+	atexit(recordEnd);
+}
+
+
+
+
+/*** Add an input on the current tick. None of the keys we act on have a
+     keysym bigger than 16 bits so anything else is ignored. ***/
+void recordInput(en_input type, KeySym ksym)
+{
+	if (!rec_fp || ksym > 0xFFFF) return;
+
+	putVarint(input_tick - rec_last_tick);
+	fputc(type,rec_fp);
+	fputc((int)(ksym & 0xFF),rec_fp);
+	fputc((int)(ksym >> 8),rec_fp);
+	fflush(rec_fp);
+	rec_last_tick = input_tick;
+}
+
+
+
+
+/*** Called at exit so we know how long to replay for ***/
+void recordEnd()
+{
+	recordInput(INPUT_END,0);
+	fclose(rec_fp);
+	rec_fp = NULL;
+}
+
+
+
+
+void putVarint(u_long val)
+{
+	for(;val >= 0x80;val >>= 7) fputc((int)(val & 0x7F) | 0x80,rec_fp);
+	fputc((int)val,rec_fp);
+}
+
+
+
+
+/*** Load the whole recording and return the seed it was made with. Exits if
+     the file can't be read, isn't a recording or stops part way through an
+     input. ***/
+uint64_t replayStart(const char *filename)
+{
+	st_input input;
+	FILE *fp;
+	char magic[4];
+	uint64_t seed;
+	u_long delta;
+	int type;
+	int lo;
+	int hi;
+	int c;
+	int i;
+
+	if (!(fp = fopen(filename,"rb")))
+	{
+		printf("ERROR: Can't open recording file '%s': %s\n",
+			filename,strerror(errno));
+		exit(1);
+	}
+	if (fread(magic,1,4,fp) != 4 ||
+	    memcmp(magic,REC_MAGIC,4) ||
+	    fgetc(fp) != REC_VERSION) goto BAD;
+
+	for(i=0,seed=0;i < 8;++i)
+	{
+		if ((lo = fgetc(fp)) == EOF) goto BAD;
+		seed |= (uint64_t)lo << (i * 8);
+	}
+
+	replay_inputs.clear();
+	input.tick = 0;
+	do
+	{
+		// No end marker if the game was killed. Ending cleanly between
+		// inputs is fine.
+		if ((c = fgetc(fp)) == EOF) break;
+		ungetc(c,fp);
+
+		if (!getVarint(fp,delta) ||
+		    (type = fgetc(fp)) == EOF || type > INPUT_END ||
+		    (lo = fgetc(fp)) == EOF ||
+		    (hi = fgetc(fp)) == EOF) goto BAD;
+
+		input.tick += delta;
+		input.type = (en_input)type;
+		input.ksym = lo | (hi << 8);
+		replay_inputs.push_back(input);
+	} while(input.type != INPUT_END);
+
+	fclose(fp);
+	replay_pos = 0;
+	return seed;
+
+	BAD:
+	printf("ERROR: '%s' is not a recording or is truncated.\n",filename);
+	exit(1);
+}
+
+
+
+
+bool getVarint(FILE *fp, u_long &val)
+{
+	int shift;
+	int c;
+
+	val = 0;
+	for(shift=0;shift < 64;shift+=7)
+	{
+		if ((c = fgetc(fp)) == EOF) return false;
+		val |= (u_long)(c & 0x7F) << shift;
+		if (!(c & 0x80)) return true;
+	}
+	return false;
+}
+
+
+
+
+/*** True while there's something left to replay ***/
+bool replaying()
+{
+	return replay_pos < replay_inputs.size();
+}
+
+
+
+
+/*** Number of ticks the recording covers ***/
+u_long replayLength()
+{
+	return replay_inputs.empty() ? 0 : replay_inputs.back().tick;
+}
+
+
+
+
+/*** Get the next input due on this tick. Returns false when there are no
+     more. INPUT_END isn't returned, it just stops the replay. ***/
+bool replayInput(en_input &type, KeySym &ksym)
+{
+	st_input *input;
+
+	if (!replaying()) return false;
+
+	input = &replay_inputs[replay_pos];
+	if (input->tick != input_tick) return false;
+
+	++replay_pos;
+	if (input->type == INPUT_END) return false;
+
+	type = input->type;
+	ksym = input->ksym;
+	return true;
+}
+
+
+
+
+/*** Called after each tick has been run ***/
+void inputTick()
+{
+	++input_tick;
+}
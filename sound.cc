@@ -45,7 +45,7 @@ short echobuff[ECHOBUFF_SIZE];
 #ifdef ALSA
 snd_pcm_t *handle;
 #else
-int sndfd;
+int sndfd = -1;
 #endif
 
 bool echo_on;
@@ -182,7 +182,8 @@ void startSoundDaemon()
 #else
 	initOpenSound();
 #endif
-	/* Set up shared memory. 10 attempts at finding a key that works.
+	/* Set up shared memory. 10 attempts at finding a key that works. The
+	   pid goes in so two games started with the same -seed don't clash.
 	   The shared memory has the following layout:
 
 	     0        1          2 
@@ -193,7 +194,7 @@ void startSoundDaemon()
 	for(i=0;i < 10 && shmid == -1;++i)
 	{
 		shmid = shmget(
-			(key_t)random(),
+			(key_t)(getRandom(RAND_SOUND) ^ getpid()),
 			sizeof(struct st_sharmem),IPC_CREAT | IPC_EXCL | 0666
 			);
 	}
@@ -225,9 +226,11 @@ void startSoundDaemon()
 		return;
 
 	case 0:
-		// Child
+		/* Child. Leaves with _exit() so the parent's atexit() handlers
+		   and stdio buffers, eg the input recording, aren't run or
+		   flushed a second time from here. */
 		soundLoop();
-		exit(0);
+		_exit(0);
 	}
 
 	// Parent ends up here
@@ -511,7 +514,8 @@ void soundLoop()
 			playfunc[snd]();
 		}
 		sleep(1);
-		exit(0);
+		fflush(stdout);
+		_exit(0);
 	}
 
 	for(check_cnt=0;;check_cnt = (check_cnt + 1) % 20)
@@ -553,7 +557,8 @@ void soundLoop()
 		{
 			puts("SOUND: Parent process dead - exiting");
 			closedown();
-			exit(0);
+			fflush(stdout);
+			_exit(0);
 		}
 	}
 }
@@ -811,7 +816,7 @@ void playSpookyHit()
 
 	for(i=0;i < 30 && PRIORITY(SND_SPOOKY_HIT);++i)
 	{
-		freq = centre + (random() % ran) - (ran / 2);
+		freq = centre + (getRandom(RAND_SOUND) % ran) - (ran / 2);
 		addSin(0,LOW_VOLUME,freq,1);
 		addSin(1,LOW_VOLUME,freq+20,0);
 		addSin(2,LOW_VOLUME,freq+40,0);
@@ -1346,7 +1351,7 @@ void addNoise(double vol, int gap, int reset)
 
 		if (!j)
 		{
-			target = (random() % (svol * 2 + 1)) - svol;
+			target = (getRandom(RAND_SOUND) % (svol * 2 + 1)) - svol;
 			inc = (target - res) / gap;
 		}
 		res = sndbuff[i] + res;
@@ -0,0 +1,291 @@
+// Frame timing. Fixed timestep scheduler running off the monotonic clock
+// and histograms of how long each part of the mainloop takes.
+
+#include "globals.h"
+
+#define TICK_NSECS        20000000ULL  // 50 ticks a second
+#define MAX_CATCHUP_TICKS 5
+
+// Each power of 2 is split into 4 buckets so percentiles are within 25%
+#define HIST_SUB_BITS 2
+#define HIST_SUB_MASK ((1 << HIST_SUB_BITS) - 1)
+#define HIST_BUCKETS  (64 << HIST_SUB_BITS)
+
+// Time the next tick is due
+static uint64_t next_tick;
+
+// Jitter stats
+static uint64_t sched_start;
+static uint64_t last_wakeup;
+static uint64_t ticks_run;
+static uint64_t ticks_dropped;
+static uint64_t catchup_frames;
+static uint64_t frames;
+static double interval_mean;
+static double interval_m2;
+static double interval_max_dev;
+static double late_total;
+static double late_max;
+
+// Phase timing histograms
+static thread_local struct st_hist
+{
+	uint64_t cnt;
+	uint64_t max;
+	uint64_t bucket[HIST_BUCKETS];
+} phase_hist[NUM_PHASES];
+
+static const char *phase_name[NUM_PHASES] =
+{
+	"X events",
+	"Object run",
+	"Collisions",
+	"During level",
+	"Draw",
+	"Swap buffers",
+	"X flush"
+};
+
+static volatile sig_atomic_t report_requested;
+
+static int histBucket(uint64_t ns);
+static uint64_t histBucketTop(int b);
+static uint64_t histPercentile(st_hist *hist, double pc);
+static void phaseSignal(int sig);
+
+
+/*** Nanoseconds since some arbitrary point. Doesn't go backwards or jump
+     when the system clock is changed ***/
+uint64_t getMonoTime()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+
+
+/*** Reset everything and set the first tick to be due now ***/
+void schedInit()
+{
+	sched_start = last_wakeup = next_tick = getMonoTime();
+	ticks_run = 0;
+	ticks_dropped = 0;
+	catchup_frames = 0;
+	frames = 0;
+	interval_mean = 0;
+	interval_m2 = 0;
+	interval_max_dev = 0;
+	late_total = 0;
+	late_max = 0;
+}
+
+
+
+
+/*** Returns how many ticks the game should run this frame. Usually 1 but if
+     we've fallen behind we run extra to catch up. This is capped so one
+     slow frame can't leave us permanently trying to catch up, in which case
+     the missed ticks are dropped and we start again from now. Returns 0 if
+     woken early ***/
+int schedTicksDue()
+{
+	uint64_t now = getMonoTime();
+	double interval;
+	double late;
+	double delta;
+	int cnt;
+
+	if (now < next_tick) return 0;
+
+	// How late we woke up and how long since the last frame
+	late = (double)(now - next_tick);
+	if (late > late_max) late_max = late;
+	late_total += late;
+
+	if (frames)
+	{
+		interval = (double)(now - last_wakeup);
+		delta = interval - interval_mean;
+		interval_mean += delta / frames;
+		interval_m2 += delta * (interval - interval_mean);
+		if (fabs(interval - TICK_NSECS) > interval_max_dev)
+			interval_max_dev = fabs(interval - TICK_NSECS);
+	}
+	last_wakeup = now;
+	++frames;
+
+	for(cnt=0;now >= next_tick && cnt < MAX_CATCHUP_TICKS;++cnt)
+		next_tick += TICK_NSECS;
+
+	if (now >= next_tick)
+	{
+		ticks_dropped += (now - next_tick) / TICK_NSECS + 1;
+		next_tick = now + TICK_NSECS;
+	}
+	if (cnt > 1) ++catchup_frames;
+	ticks_run += cnt;
+
+	return cnt;
+}
+
+
+
+
+/*** Sleep until the next tick is due. Uses an absolute deadline so time spent
+     running the frame doesn't get added on to the delay ***/
+void schedWait()
+{
+	timespec ts;
+
+	ts.tv_sec = next_tick / 1000000000ULL;
+	ts.tv_nsec = next_tick % 1000000000ULL;
+
+	// Will return early on a signal but schedTicksDue() copes with that
+	clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL);
+}
+
+
+
+
+/*** Print the achieved tick rate and how much the frame times varied ***/
+void schedReport()
+{
+	double secs = (double)(getMonoTime() - sched_start) / 1e9;
+	double sd = frames > 2 ? sqrt(interval_m2 / (frames - 2)) : 0;
+
+	if (!frames) return;
+
+	printf("Tick rate   : %.2f/sec (target %.0f)\n",
+		secs > 0 ? ticks_run / secs : 0,1e9 / TICK_NSECS);
+	printf("Frame jitter: mean %.3fms, sd %.3fms, max dev %.3fms\n",
+		interval_mean / 1e6,sd / 1e6,interval_max_dev / 1e6);
+	printf("Late wakeup : mean %.3fms, max %.3fms\n",
+		late_total / frames / 1e6,late_max / 1e6);
+	printf("Catch up    : %lu frames ran extra ticks, %lu ticks dropped\n",
+		(u_long)catchup_frames,(u_long)ticks_dropped);
+}
+
+
+
+/////////////////////////////// PHASE TIMING /////////////////////////////////
+
+/*** Clear the histograms and have SIGUSR1 print them out ***/
+void phaseInit()
+{
+	bzero(phase_hist,sizeof(phase_hist));
+	report_requested = 0;
+	signal(SIGUSR1,phaseSignal);
+}
+
+
+
+
+/*** Add the time since start to the phase histogram ***/
+void phaseAdd(en_phase phase, uint64_t start)
+{
+	st_hist *hist = &phase_hist[phase];
+	uint64_t ns = getMonoTime() - start;
+
+	++hist->bucket[histBucket(ns)];
+	++hist->cnt;
+	if (ns > hist->max) hist->max = ns;
+}
+
+
+
+
+/*** Can't printf() in a signal handler so just set a flag for mainloop ***/
+void phaseSignal(int sig)
+{
+	report_requested = 1;
+}
+
+
+
+
+/*** Called from mainloop. Print the report if SIGUSR1 has been received ***/
+void phaseCheckSignal()
+{
+	if (report_requested)
+	{
+		report_requested = 0;
+		phaseReport();
+	}
+}
+
+
+
+
+/*** Print the percentiles for each phase in microseconds ***/
+void phaseReport()
+{
+	st_hist *hist;
+
+	printf("Phase timings (usecs):\n");
+	printf("    %-13s %9s %9s %9s %9s %9s\n",
+		"PHASE","COUNT","P50","P95","P99","MAX");
+
+	for(int i=0;i < NUM_PHASES;++i)
+	{
+		hist = &phase_hist[i];
+		if (!hist->cnt) continue;
+
+		printf("    %-13s %9lu %9.1f %9.1f %9.1f %9.1f\n",
+			phase_name[i],
+			(u_long)hist->cnt,
+			histPercentile(hist,0.5) / 1e3,
+			histPercentile(hist,0.95) / 1e3,
+			histPercentile(hist,0.99) / 1e3,
+			hist->max / 1e3);
+	}
+	fflush(stdout);
+}
+
+
+
+
+/*** Log scale bucket. Values under 4ns get their own bucket, after that its
+     the top bit position plus the next 2 bits below it ***/
+int histBucket(uint64_t ns)
+{
+	int msb;
+
+	if (ns <= HIST_SUB_MASK) return (int)ns;
+
+	msb = 63 - __builtin_clzll(ns);
+	return (msb << HIST_SUB_BITS) | 
+	       (int)((ns >> (msb - HIST_SUB_BITS)) & HIST_SUB_MASK);
+}
+
+
+
+
+/*** Largest value that goes in the given bucket ***/
+uint64_t histBucketTop(int b)
+{
+	int msb = b >> HIST_SUB_BITS;
+	int sub = b & HIST_SUB_MASK;
+
+	if (b <= HIST_SUB_MASK) return b;
+	return ((uint64_t)((1 << HIST_SUB_BITS) + sub + 1) << 
+	        (msb - HIST_SUB_BITS)) - 1;
+}
+
+
+
+
+/*** Estimate percentile as the top of the bucket it falls in ***/
+uint64_t histPercentile(st_hist *hist, double pc)
+{
+	uint64_t want = (uint64_t)ceil(pc * hist->cnt);
+	uint64_t total = 0;
+
+	for(int b=0;b < HIST_BUCKETS;++b)
+	{
+		if ((total += hist->bucket[b]) >= want)
+			return min(histBucketTop(b),hist->max);
+	}
+	return hist->max;
+}
@@ -1,35 +1,165 @@
 #include "globals.h"
 
+/* The state kept here is in st_game:
+
+   tunnel_slots - A slot per tunnel. See st_tunnel_slot.
+   path_dist    - Distance in links and the next tunnel to head for between
+   path_next      every pair of tunnels indexed by cl_tunnel::id.
+   player_dist  - Distance in links from every tunnel to the player's tunnel.
+   tunnel_cols  - Same bits as tunnel_bitmap but stored by column so
+                  wallDistY() can scan down a column a word at a time.
+   collinear    - Spatial index. Collinear tunnels are found by their x if
+   tun_grid       vertical or y if horizontal. Overlapping ones by a grid of
+                  cells each holding the tunnels whose box touches it.
+                  Everything is kept in tunnels[] order so searches find
+                  tunnels in the same order as going through the list.
+   dig_watches  - Things waiting for ground to be dug. */
+
+static void clearTunnelIndex();
+static void indexInsert(vector<cl_tunnel *> &list, cl_tunnel *tun);
+static void indexRemove(vector<cl_tunnel *> &list, cl_tunnel *tun);
+static int tunnelCell(int v);
+static void clearBits(uint64_t *words, int b1, int b2);
+static int firstSetBit(uint64_t *words, int from, int to);
+static int lastSetBit(uint64_t *words, int from, int to);
+static void buildPaths();
+static void buildPlayerDist(cl_tunnel *to);
+
 
 /*** Create a tunnel and add it to the list. Only have 1 coordinate pair because
      we don't know which direction tunnel will go in yet ***/
 cl_tunnel *createTunnel(int x, int y)
 {
 	cl_tunnel *tun = new cl_tunnel(x,y);
-	tunnels.push_back(tun);
+	st_tunnel_slot *slot;
+
+	if (game->slots_used == (int)game->tunnel_slots.size())
+		game->tunnel_slots.push_back({ NULL, 0, -1, 0 });
+	tun->slot = game->slots_used++;
+	slot = &game->tunnel_slots[tun->slot];
+	slot->tun = tun;
+	slot->fwd_slot = -1;
+
+	tun->id = (int)game->tunnels.size();
+	game->tunnels.push_back(tun);
+	indexTunnel(tun);
+	invalidatePaths();
 	return tun;
 }
 
 
 
 
+/*** Get rid of a tunnel complete() has found is part of another one. Its 
+     slot forwards to the other tunnel's so anything holding a handle to it
+     now has one to that instead. ***/
+void mergeTunnel(cl_tunnel *from, cl_tunnel *into)
+{
+	st_tunnel_slot *slot = &game->tunnel_slots[from->slot];
+
+	slot->tun = NULL;
+	slot->fwd_slot = into->slot;
+	slot->fwd_gen = game->tunnel_slots[into->slot].gen;
+	delete from;
+}
+
+
+
+
+/*** Returns the tunnel the handle refers to following any merges or NULL 
+     if the tunnels have been cleared down since it was made ***/
+cl_tunnel *cl_tunnel_ref::get() const
+{
+	st_tunnel_slot *s;
+	int sl = slot;
+	uint32_t gn = gen;
+
+	while(sl != -1)
+	{
+		s = &game->tunnel_slots[sl];
+		if (s->gen != gn) return NULL;
+		if (s->tun) return s->tun;
+		sl = s->fwd_slot;
+		gn = s->fwd_gen;
+	}
+	return NULL;
+}
+
+
+
+
+cl_tunnel_ref::cl_tunnel_ref(cl_tunnel *tun)
+{
+	if (tun)
+	{
+		slot = tun->slot;
+		gen = game->tunnel_slots[slot].gen;
+	}
+	else
+	{
+		slot = -1;
+		gen = 0;
+	}
+}
+
+
+
+
+/*** True if our tunnel has been merged into another one ***/
+bool cl_tunnel_ref::merged() const
+{
+	return slot != -1 &&
+	       game->tunnel_slots[slot].gen == gen &&
+	       !game->tunnel_slots[slot].tun &&
+	       game->tunnel_slots[slot].fwd_slot != -1;
+}
+
+
+
+
+/*** Point straight at the tunnel we were merged into ***/
+void cl_tunnel_ref::follow()
+{
+	if (merged()) *this = cl_tunnel_ref(get());
+}
+
+
+
+
 /*** Cleardown everything and set up the start tunnels ***/
 void initTunnels()
 {
-	vector<cl_tunnel *>::iterator it;
 	cl_tunnel *tun;
 	int vert_y;
 	int horiz_x1;
 	int horiz_x2;
 	int val;
 
-	for(it=tunnels.begin();it != tunnels.end();++it) delete *it;
-	tunnels.clear();
-	tunnels.reserve(20);
+	clearTunnelIndex();
+	freeTunnels();
 
-	memset(tunnel_bitmap,1,sizeof(tunnel_bitmap));
+	// Make every existing handle stale
+	for(auto &slot: game->tunnel_slots)
+	{
+		slot.tun = NULL;
+		slot.fwd_slot = -1;
+		++slot.gen;
+	}
+	game->slots_used = 0;
+	game->tunnels.reserve(20);
+	invalidatePaths();
 
-	val = 30 * level;
+	memset(game->tunnel_bitmap,0xFF,sizeof(game->tunnel_bitmap));
+	memset(game->tunnel_cols,0xFF,sizeof(game->tunnel_cols));
+	groundInit();
+	invalidateBackground();
+
+	// The ground being watched has gone. Boulders set their watches again
+	// once they're running.
+	for(auto watch: game->dig_watches) watch->watching = false;
+	game->dig_watches.clear();
+
+	val = 30 * game->level;
 
 	// Create vertical start tunnel
 	vert_y = SCR_MID + 150 + val;
@@ -60,22 +190,108 @@ void initTunnels()
 
 
 
-/*** Fill an area with a tunnel - used for movement ***/
+/*** Delete every tunnel. Handles to them aren't made stale so this is only
+     for initTunnels() and freeing the game. ***/
+void freeTunnels()
+{
+	for(auto tun: game->tunnels) delete tun;
+	game->tunnels.clear();
+}
+
+
+
+
+/*** Fill an area with a tunnel - used for movement. Clips to the screen
+     then clears the rows in tunnel_bitmap and the columns in tunnel_cols.
+     ground.cc clips it to the play area itself. ***/
 void fillTunnelArea(int x1, int y1, int x2, int y2)
 {
-	int x;
-	int y;
+	int cx1 = max(x1,0);
+	int cx2 = min(x2,SCR_SIZE - 1);
+	int cy1 = max(y1,0);
+	int cy2 = min(y2,SCR_SIZE - 1);
+	int i;
 
 	assert(x1 <= x2 && y1 <= y2);
 
-	for(x=x1;x <= x2;++x)
+	if (cx1 <= cx2 && cy1 <= cy2)
 	{
-		if (x < 0 || x >= SCR_SIZE) continue;
-		for(y=y1;y <= y2;++y)
+		for(i=cy1;i <= cy2;++i) clearBits(game->tunnel_bitmap[i],cx1,cx2);
+		for(i=cx1;i <= cx2;++i) clearBits(game->tunnel_cols[i],cy1,cy2);
+
+		// Tell anyone whose area we've just dug into. Above the play
+		// area doesn't count as tunnel.
+		cy1 = max(cy1,PLAY_AREA_TOP);
+		for(auto watch: game->dig_watches)
 		{
-			if (y >= 0 && y < SCR_SIZE) tunnel_bitmap[x][y] = 0;
+			if (watch->x1 <= cx2 && watch->x2 >= cx1 &&
+			    watch->y1 <= cy2 && watch->y2 >= cy1)
+				watch->dug = true;
 		}
 	}
+	groundDig(x1,y1,x2,y2);
+	digBackground(x1,y1,x2,y2);
+}
+
+
+
+
+/*** Start watching an area or move an existing watch to a new one. dug is
+     set straight away if any of it is already tunnel. ***/
+void watchDigArea(st_dig_watch *watch, int x1, int y1, int x2, int y2)
+{
+	int x;
+	int y;
+
+	assert(x1 <= x2 && y1 <= y2);
+
+	watch->x1 = x1;
+	watch->y1 = y1;
+	watch->x2 = x2;
+	watch->y2 = y2;
+	watch->dug = false;
+
+	for(y=y1;y <= y2 && !watch->dug;++y)
+		for(x=x1;x <= x2 && !watch->dug;++x) watch->dug = insideTunnel(x,y);
+
+	if (!watch->watching)
+	{
+		game->dig_watches.push_back(watch);
+		watch->watching = true;
+	}
+}
+
+
+
+
+void unwatchDigArea(st_dig_watch *watch)
+{
+	if (!watch->watching) return;
+	game->dig_watches.erase(
+		find(game->dig_watches.begin(),game->dig_watches.end(),watch));
+	watch->watching = false;
+}
+
+
+
+
+/*** Clear bits b1 to b2 inclusive. Whole 64 bit words are cleared with 
+     masks for the words at each end. ***/
+void clearBits(uint64_t *words, int b1, int b2)
+{
+	uint64_t first_mask = ~0ULL << (b1 & 63);
+	uint64_t last_mask = ~0ULL >> (63 - (b2 & 63));
+	int w1 = b1 >> 6;
+	int w2 = b2 >> 6;
+
+	if (w1 == w2)
+	{
+		words[w1] &= ~(first_mask & last_mask);
+		return;
+	}
+	words[w1] &= ~first_mask;
+	for(++w1;w1 < w2;++w1) words[w1] = 0;
+	words[w2] &= ~last_mask;
 }
 
 
@@ -84,7 +300,7 @@ void fillTunnelArea(int x1, int y1, int x2, int y2)
 /*** Return one if co-ordinate is outside a tunnel or offscreen ***/
 bool outsideTunnel(int x, int y)
 {
-	return (offscreen(x,y) || tunnel_bitmap[x][y]);
+	return !ONSCREEN(x,y) || IS_GROUND(x,y);
 }
 
 
@@ -99,41 +315,390 @@ bool insideTunnel(int x, int y)
 
 
 
+/*** Same as stepping along the row from x by add (1 or -1) up to len pixels
+     until outsideTunnel() is true. Returns how many pixels along that 
+     happened or -1 if it didn't. The bits past the right edge of the screen
+     are never cleared so they act as the wall there. ***/
+int wallDistX(int x, int y, int add, int len)
+{
+	int b;
+
+	if (!ONSCREEN(x,y)) return 0;
+
+	if (add > 0)
+	{
+		b = firstSetBit(game->tunnel_bitmap[y],x,min(x + len,SCR_SIZE));
+		return b == -1 ? -1 : b - x;
+	}
+	if ((b = lastSetBit(game->tunnel_bitmap[y],x,max(x - len,0))) != -1)
+		return x - b;
+
+	// Off the left edge
+	return x - len < 0 ? x + 1 : -1;
+}
+
+
+
+
+/*** As above going up or down a column. The top of the play area is the
+     wall going up. ***/
+int wallDistY(int x, int y, int add, int len)
+{
+	int b;
+
+	if (!ONSCREEN(x,y)) return 0;
+
+	if (add > 0)
+	{
+		b = firstSetBit(game->tunnel_cols[x],y,min(y + len,SCR_SIZE));
+		return b == -1 ? -1 : b - y;
+	}
+	b = lastSetBit(game->tunnel_cols[x],y,max(y - len,PLAY_AREA_TOP));
+	if (b != -1) return y - b;
+
+	return y - len < PLAY_AREA_TOP ? y - PLAY_AREA_TOP + 1 : -1;
+}
+
+
+
+
+/*** Returns the lowest set bit from bit "from" up to "to" inclusive or -1 ***/
+int firstSetBit(uint64_t *words, int from, int to)
+{
+	uint64_t bits;
+	int w = from >> 6;
+	int b;
+
+	for(bits=words[w] & (~0ULL << (from & 63));!bits;bits=words[w])
+		if (++w > (to >> 6)) return -1;
+
+	b = (w << 6) + __builtin_ctzll(bits);
+	return b <= to ? b : -1;
+}
+
+
+
+
+/*** Returns the highest set bit from bit "from" down to "to" inclusive or 
+     -1 ***/
+int lastSetBit(uint64_t *words, int from, int to)
+{
+	uint64_t bits;
+	int w = from >> 6;
+	int b;
+
+	for(bits=words[w] & (~0ULL >> (63 - (from & 63)));!bits;bits=words[w])
+		if (--w < (to >> 6)) return -1;
+
+	b = (w << 6) + 63 - __builtin_clzll(bits);
+	return b >= to ? b : -1;
+}
+
+
+
+
+////////////////////////////// SPATIAL INDEX ///////////////////////////////
+
+/*** Add the tunnel to the index or move it if its direction or box has 
+     changed since it was last indexed ***/
+void indexTunnel(cl_tunnel *tun)
+{
+	int coord = tun->vert ? tun->x1 : tun->y1;
+	int cx1 = tunnelCell(tun->min_x);
+	int cy1 = tunnelCell(tun->min_y);
+	int cx2 = tunnelCell(tun->max_x);
+	int cy2 = tunnelCell(tun->max_y);
+	int cx;
+	int cy;
+
+	if (tun->indexed)
+	{
+		if (tun->idx_vert == tun->vert && 
+		    tun->idx_coord == coord &&
+		    tun->idx_cx1 == cx1 && tun->idx_cy1 == cy1 &&
+		    tun->idx_cx2 == cx2 && tun->idx_cy2 == cy2) return;
+		unindexTunnel(tun);
+	}
+
+	tun->indexed = true;
+	tun->idx_vert = tun->vert;
+	tun->idx_coord = coord;
+	tun->idx_cx1 = cx1;
+	tun->idx_cy1 = cy1;
+	tun->idx_cx2 = cx2;
+	tun->idx_cy2 = cy2;
+
+	indexInsert(game->collinear[tun->vert][coord],tun);
+	for(cy=cy1;cy <= cy2;++cy)
+		for(cx=cx1;cx <= cx2;++cx) indexInsert(game->tun_grid[cy][cx],tun);
+}
+
+
+
+
+void unindexTunnel(cl_tunnel *tun)
+{
+	int cx;
+	int cy;
+
+	if (!tun->indexed) return;
+
+	indexRemove(game->collinear[tun->idx_vert][tun->idx_coord],tun);
+	for(cy=tun->idx_cy1;cy <= tun->idx_cy2;++cy)
+	{
+		for(cx=tun->idx_cx1;cx <= tun->idx_cx2;++cx)
+			indexRemove(game->tun_grid[cy][cx],tun);
+	}
+	tun->indexed = false;
+}
+
+
+
+
+/*** Vertical tunnels with the given x or horizontal ones with the given y ***/
+vector<cl_tunnel *> &collinearTunnels(bool vert, int coord)
+{
+	return game->collinear[vert][coord];
+}
+
+
+
+
+/*** Every other tunnel whose box shares a grid cell with this one's. Any 
+     tunnel that overlaps it will be in here. ***/
+void nearTunnels(cl_tunnel *tun, vector<cl_tunnel *> &near)
+{
+	int cx;
+	int cy;
+
+	near.clear();
+	for(cy=tunnelCell(tun->min_y);cy <= tunnelCell(tun->max_y);++cy)
+	{
+		for(cx=tunnelCell(tun->min_x);cx <= tunnelCell(tun->max_x);++cx)
+		{
+			for(auto t: game->tun_grid[cy][cx])
+				if (t != tun) near.push_back(t);
+		}
+	}
+	sort(near.begin(),near.end(),
+		[](cl_tunnel *a, cl_tunnel *b) { return a->id < b->id; });
+	near.erase(unique(near.begin(),near.end()),near.end());
+}
+
+
+
+
+void clearTunnelIndex()
+{
+	int cx;
+	int cy;
+
+	for(auto tun: game->tunnels) tun->indexed = false;
+	game->collinear[0].clear();
+	game->collinear[1].clear();
+	for(cy=0;cy < TUN_CELLS;++cy)
+		for(cx=0;cx < TUN_CELLS;++cx) game->tun_grid[cy][cx].clear();
+}
+
+
+
+
+/*** Lists are short so just keep them sorted by id ***/
+void indexInsert(vector<cl_tunnel *> &list, cl_tunnel *tun)
+{
+	vector<cl_tunnel *>::iterator it;
+
+	for(it=list.end();it != list.begin() && (*(it-1))->id > tun->id;--it);
+	list.insert(it,tun);
+}
+
+
+
+
+void indexRemove(vector<cl_tunnel *> &list, cl_tunnel *tun)
+{
+	list.erase(find(list.begin(),list.end(),tun));
+}
+
+
+
+
+/*** Anything off the screen goes in the edge cells ***/
+int tunnelCell(int v)
+{
+	int c = (v < 0 ? 0 : v / TUN_CELL_SIZE);
+	return c >= TUN_CELLS ? TUN_CELLS - 1 : c;
+}
+
+
+////////////////////////////////// PATHS //////////////////////////////////////
+
+/*** Path tables have to be rebuilt. Called whenever a tunnel is created or
+     removed or links change. ***/
+void invalidatePaths()
+{
+	game->paths_valid = false;
+	game->player_dist_valid = false;
+}
+
+
+
+
 /*** Find the shortest path - in number of links , not necessarily distance
-     but frankly who cares - from given tunnel to next tunnel ***/
+     but frankly who cares - from given tunnel to next tunnel. next is set to 
+     the tunnel to head for. Returns -1 if there's no path within max_depth
+     links. ***/
 int findShortestPath(
-	int depth,
-	int max_depth, cl_tunnel *from, cl_tunnel *to, cl_tunnel *&next)
+	int max_depth, cl_tunnel *from, cl_tunnel *to, cl_tunnel_ref &next)
 {
-	vector<cl_tunnel *>::iterator it;
-	vector<cl_tunnel *>::iterator best_it;
-	bool first;
-	int res;
-	int min = -1;
+	int i;
+	int dist;
+
+	if (from == to)
+	{
+		next = to;
+		return 0;
+	}
+	if (!to) return -1;
+	if (!game->paths_valid) buildPaths();
+
+	i = from->id * game->num_paths + to->id;
+	if ((dist = game->path_dist[i]) == -1 || dist > max_depth) return -1;
+
+	next = game->tunnels[game->path_next[i]];
+	return dist;
+}
+
+
+
+
+/*** Same as findShortestPath() to the player's tunnel but every enemy 
+     chasing the player shares one distance field. It's only rebuilt when
+     the player moves into another tunnel or the tunnels change so the cost
+     doesn't go up with the number of enemies. ***/
+int findPathToPlayer(int max_depth, cl_tunnel *from, cl_tunnel_ref &next)
+{
+	cl_tunnel *to = game->player->curr_tunnel;
+	int dist;
 
 	if (from == to)
 	{
 		next = to;
 		return 0;
 	}
-	if (from->recursed || depth == max_depth) return -1;
+	if (!game->player_dist_valid || game->player_dist_tun != to)
+		buildPlayerDist(to);
 
-	from->recursed = true;
-	first = true;
+	if ((dist = game->player_dist[from->id]) == -1 || dist > max_depth)
+		return -1;
 
-	for(it=from->links.begin();it != from->links.end();++it)
+	// Same choice of link as buildPaths() makes
+	for(auto link: from->links)
 	{
-		res = findShortestPath(depth+1,max_depth,*it,to,next);
-		if (res != -1 && (first || res < min))
+		if (game->player_dist[link->id] == dist - 1)
 		{
-			best_it = it;
-			min = res;
-			first = false;
+			next = link;
+			break;
 		}
 	}
-	from->recursed = false;
+	return dist;
+}
+
+
 
-	if (min == -1) return -1;
-	next = *best_it;
-	return 1 + min;
+
+/*** Breadth first search out from the player's tunnel. Links always go
+     both ways so this is also the distance to it. ***/
+void buildPlayerDist(cl_tunnel *to)
+{
+	vector<cl_tunnel *> queue;
+	int d;
+
+	game->player_dist.assign(game->tunnels.size(),-1);
+	game->player_dist_tun = to;
+	game->player_dist_valid = true;
+	if (!to) return;
+
+	game->player_dist[to->id] = 0;
+	queue.push_back(to);
+
+	for(size_t head=0;head < queue.size();++head)
+	{
+		d = game->player_dist[queue[head]->id] + 1;
+		for(auto link: queue[head]->links)
+		{
+			if (game->player_dist[link->id] == -1)
+			{
+				game->player_dist[link->id] = d;
+				queue.push_back(link);
+			}
+		}
+	}
+}
+
+
+
+
+/*** Breadth first search from every tunnel to get the distance in links
+     between every pair. The next hop is the first link, in links order, 
+     that is one step closer. This is what the old depth first search used 
+     to find so the enemies still pick the same routes. ***/
+void buildPaths()
+{
+	vector<int> queue;
+	cl_tunnel *tun;
+	int *dist;
+	int head;
+	int from;
+	int n;
+	int to;
+	int d;
+	int i;
+
+	n = game->num_paths = (int)game->tunnels.size();
+
+	game->path_dist.assign(n * n,-1);
+	game->path_next.assign(n * n,-1);
+	queue.resize(n);
+
+	for(from=0;from < n;++from)
+	{
+		dist = &game->path_dist[from * n];
+		dist[from] = 0;
+		queue[0] = from;
+
+		for(head=0,i=1;head < i;++head)
+		{
+			tun = game->tunnels[queue[head]];
+			d = dist[tun->id] + 1;
+			for(auto link: tun->links)
+			{
+				if (dist[link->id] == -1)
+				{
+					dist[link->id] = d;
+					queue[i++] = link->id;
+				}
+			}
+		}
+	}
+
+	for(from=0;from < n;++from)
+	{
+		tun = game->tunnels[from];
+		for(to=0;to < n;++to)
+		{
+			if (to == from || (d = game->path_dist[from * n + to]) == -1)
+				continue;
+
+			for(auto link: tun->links)
+			{
+				if (game->path_dist[link->id * n + to] == d - 1)
+				{
+					game->path_next[from * n + to] = link->id;
+					break;
+				}
+			}
+		}
+	}
+	game->paths_valid = true;
 }